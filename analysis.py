@@ -22,13 +22,18 @@ def collect_data():
     optset = set()
     for file in glob.glob("data/*.dat"):
         alg, opt = parse_data_name(file)
-        optset.add(opt)
         data[alg, opt] = ([], [])
         with open(file, 'r') as dat:
             for line in dat.readlines():
-                n, _, time = map(lambda s: s.strip(), line.split('::'))
+                n, _, time, *_ = map(lambda s: s.strip(), line.split('::'))
                 data[alg, opt][0].append(int(n))
                 data[alg, opt][1].append(float(time))
+        # (a run can time out before its first index: nothing to plot)
+        if not data[alg, opt][0]:
+            print(f"{alg}[{opt}]: no samples", file=sys.stderr)
+            del data[alg, opt]
+            continue
+        optset.add(opt)
     
     return data, optset
 
@@ -54,7 +59,9 @@ if __name__ == "__main__":
     
     #plt.xscale('log')
     for alg, opt in sorted(data):
-        axmap[opt].plot(data[alg, opt][0], data[alg, opt][1], label=f"{alg}")
+        # (bisection visits the indices out of order)
+        xs, ys = zip(*sorted(zip(*data[alg, opt])))
+        axmap[opt].plot(xs, ys, label=f"{alg}")
     for alg, opt in sorted(data, key=lambda p: restricted_max(data[p])):        
         print(f"{alg}[{opt}]:", restricted_max(data[alg, opt]))
 
@@ -0,0 +1,466 @@
+/* Differential checks and a timing regression gate
+ *
+ *   --kernels         multiplies random and adversarial operands (all-ones
+ *                     limbs, sparse limbs, sizes around powers of two) with
+ *                     every backend, against schoolbook multiplication
+ *   --fib=N           prints the size and a digest of fibonacci(N), for
+ *                     comparing implementations (see `make check-impl`),
+ *                     after checking it modulo 2^61 - 1 against fib/modular.h
+ *   --batch=N,N,...   computes the indices in one batch (see fib/batch.h),
+ *                     and compares each result with fibonacci(N)
+ *   --leading=N,N,... compares the leading digits from fib/leading.h (for a
+ *                     few digit counts, up to all of them) with the decimal
+ *                     expansion of fibonacci(N)
+ *   --small           compares fib/small.h, for every index it covers (and
+ *                     just past it, where it must decline), with F(n) by
+ *                     additions
+ *   --timing=FILE     times a fixed set of kernels, and fails if any is
+ *                     slower than in the baseline FILE by more than the
+ *                     threshold (timings only compare on one machine, so
+ *                     if FILE is missing, or with --update, this run's
+ *                     timings are written to it instead)
+ *
+ * Exits with 1 on any failure.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <optional>
+#include <random>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "fib_base.h"
+#include "options.h"
+#include "num/number.h"
+#include "num/mulnum_simple.h"
+#include "num/mulnum_karatsuba.h"
+#include "num/mulnum_dft.h"
+#include "num/mulnum_fft.h"
+#include "num/decimal.h"
+#include "fib/leading.h"
+#include "fib/modular.h"
+#include "fib/small.h"
+
+using sec_t = std::chrono::duration<double>;
+using big::num_t;
+using u8 = std::uint8_t;
+using u32 = std::uint32_t;
+using u64 = std::uint64_t;
+
+std::mt19937_64 rng(1);
+
+/* operands of a given size, in a given style */
+enum class shape { random, ones, sparse, top_only };
+
+template<big::UInt T>
+num_t<T> operand(size_t limbs, shape s)
+{
+    std::vector<T> v(limbs);
+    for (size_t i = 0; i < limbs; ++i)
+    {
+        switch (s)
+        {
+        case shape::random: v[i] = static_cast<T>(rng()); break;
+        case shape::ones: v[i] = static_cast<T>(-1); break;
+        case shape::sparse: v[i] = rng() % 8 == 0 ? static_cast<T>(rng()) : 0; break;
+        case shape::top_only: v[i] = i + 1 == limbs ? static_cast<T>(-1) : 0; break;
+        }
+    }
+    return v;
+}
+
+/* sizes (in 64-bit words) up to max: small ones, then 2^k - 1, 2^k, 2^k + 1 */
+std::vector<size_t> sizes(size_t max)
+{
+    std::vector<size_t> out { 0, 1, 2, 3, 5, 7 };
+    for (size_t p = 8; p <= max; p <<= 1)
+    {
+        out.insert(out.end(), { p - 1, p, p + 1 });
+    }
+    return out;
+}
+
+bool check_kernels()
+{
+    // the reference is schoolbook on 32-bit limbs; every other backend is
+    // compared after converting back
+    using ref = big::simple::backend;
+    using mul_t = std::function<num_t<u32>(const num_t<u32> &, const num_t<u32> &)>;
+    const std::vector<std::pair<std::string, mul_t>> backends {
+        { "karatsuba", [](const num_t<u32> &a, const num_t<u32> &b) { return big::product<big::karatsuba::backend>(a, b); } },
+        { "karatsuba_cutoff", [](const num_t<u32> &a, const num_t<u32> &b) { return big::product<big::karatsuba::cutoff_backend<>>(a, b); } },
+        { "fft", [](const num_t<u32> &a, const num_t<u32> &b)
+            {
+                return static_cast<num_t<u32>>(big::product<big::fft::backend>(static_cast<num_t<u8>>(a), static_cast<num_t<u8>>(b)));
+            } },
+        { "dft", [](const num_t<u32> &a, const num_t<u32> &b)
+            {
+                return static_cast<num_t<u32>>(big::product<big::dft::backend>(static_cast<num_t<u8>>(a), static_cast<num_t<u8>>(b)));
+            } },
+    };
+
+    size_t checks = 0;
+    size_t failures = 0;
+    for (size_t words : sizes(2048))
+    {
+        for (shape sa : { shape::random, shape::ones, shape::sparse, shape::top_only })
+        {
+            for (shape sb : { shape::random, shape::ones })
+            {
+                // square, and unbalanced operands
+                for (size_t other : { words, words / 3 + 1 })
+                {
+                    num_t<u32> a = operand<u32>(2 * words, sa);
+                    num_t<u32> b = other == words && sa == sb ? a : operand<u32>(2 * other, sb);
+                    num_t<u32> expected = big::product<ref>(a, b);
+                    for (const auto &[name, mul] : backends)
+                    {
+                        if (name == "dft" && words > 256)
+                        {
+                            continue; // quadratic
+                        }
+                        ++checks;
+                        if (mul(a, b) != expected)
+                        {
+                            ++failures;
+                            std::cerr << "FAIL: " << name << " on " << a.value.size() << " x " << b.value.size() << " limbs" << std::endl;
+                        }
+                    }
+                    if (other != words || sb != shape::random)
+                    {
+                        continue;
+                    }
+                    num_t<u32> expected_square = big::product<ref>(a, a);
+                    ++checks;
+                    if (big::square<big::karatsuba::backend>(a) != expected_square)
+                    {
+                        ++failures;
+                        std::cerr << "FAIL: karatsuba square on " << a.value.size() << " limbs" << std::endl;
+                    }
+                    ++checks;
+                    if (static_cast<num_t<u32>>(big::square<big::fft::backend>(static_cast<num_t<u8>>(a))) != expected_square)
+                    {
+                        ++failures;
+                        std::cerr << "FAIL: fft square on " << a.value.size() << " limbs" << std::endl;
+                    }
+                }
+            }
+        }
+    }
+
+    // decimal conversion, against the quadratic one (across the size where
+    // the divide-and-conquer kicks in)
+    for (size_t words : sizes(1 << 14))
+    {
+        num_t<u64> x = operand<u64>(words, shape::random);
+        std::vector<u32> expected(words * 64 / 29 + 2);
+        big::decimal_leaf_blocks(static_cast<num_t<u32>>(x), expected.data(), expected.size());
+        while (!expected.empty() && !expected.back())
+        {
+            expected.pop_back();
+        }
+        ++checks;
+        if (big::decimal_blocks(x) != expected)
+        {
+            ++failures;
+            std::cerr << "FAIL: decimal conversion of " << words << " words" << std::endl;
+        }
+    }
+
+    std::cout << "kernels: " << checks - failures << "/" << checks << " passed" << std::endl;
+    return failures == 0;
+}
+
+bool check_fib(const number &n)
+{
+    number f = fibonacci(n);
+
+    // x mod 2^61 - 1 (Horner over the words)
+    constexpr u64 p = (u64(1) << 61) - 1;
+    unsigned __int128 rem = 0;
+    for (auto rit = f.value.rbegin(); rit != f.value.rend(); ++rit)
+    {
+        rem = ((rem << 64) | *rit) % p;
+    }
+    u64 expected = fib::fibonacci_mod(n, p);
+    if (static_cast<u64>(rem) != expected)
+    {
+        std::cerr << "FAIL: F(" << n.str(true) << ") mod 2^61 - 1 is " << static_cast<u64>(rem) << ", expected " << expected << std::endl;
+        return false;
+    }
+
+    // FNV-1a over the words
+    u64 digest = 0xcbf29ce484222325;
+    for (u64 word : f.value)
+    {
+        for (int i = 0; i < 64; i += 8)
+        {
+            digest = (digest ^ ((word >> i) & 0xff)) * 0x100000001b3;
+        }
+    }
+    std::cout << f.bit_width() << " bits, digest " << std::hex << std::setw(16) << std::setfill('0') << digest << std::endl;
+    return true;
+}
+
+bool check_batch(const std::vector<number> &ns)
+{
+    std::vector<number> got = fibonacci(std::span<const number>(ns));
+    if (got.size() != ns.size())
+    {
+        std::cerr << "FAIL: batch of " << ns.size() << " indices returned " << got.size() << " results" << std::endl;
+        return false;
+    }
+    size_t failures = 0;
+    for (size_t i = 0; i < ns.size(); ++i)
+    {
+        if (got[i] != fibonacci(ns[i]))
+        {
+            ++failures;
+            std::cerr << "FAIL: batch F(" << ns[i].str(true) << ") differs from fibonacci" << std::endl;
+        }
+    }
+    std::cout << std::dec << "batch: " << ns.size() - failures << "/" << ns.size() << " agree" << std::endl;
+    return failures == 0;
+}
+
+bool check_leading(const std::vector<number> &ns)
+{
+    size_t checks = 0;
+    size_t failures = 0;
+    for (const number &n : ns)
+    {
+        std::string all = fibonacci(n).str(true);
+        std::vector<size_t> counts { 1, 2, 10, 64, 300 };
+        if (all.size() <= 1000)
+        {
+            counts.insert(counts.end(), { all.size() - 1, all.size(), all.size() + 1 });
+        }
+        for (size_t k : counts)
+        {
+            if (k == 0)
+            {
+                continue;
+            }
+            fib::scientific got = fib::leading_digits(n, k);
+            ++checks;
+            if (got.digits != all.substr(0, k) || got.exponent != all.size() - 1 || (got.exact && all.size() > k))
+            {
+                ++failures;
+                std::cerr << "FAIL: leading " << k << " digits of F(" << n.str(true) << "): " << got.str() << std::endl;
+            }
+        }
+    }
+    std::cout << "leading: " << checks - failures << "/" << checks << " passed" << std::endl;
+    return failures == 0;
+}
+
+bool check_small()
+{
+    constexpr std::uint64_t limit = fib::small_limit<fib::small_limbs>;
+    size_t failures = 0;
+    number a = 0; // F(n)
+    number b = 1; // F(n+1)
+    for (std::uint64_t n = 0; n < limit + 8; ++n)
+    {
+        std::optional<number> got = fib::small_fibonacci(number(n));
+        if (n < limit ? !got || *got != a : got.has_value())
+        {
+            ++failures;
+            std::cerr << "FAIL: small F(" << n << ")" << std::endl;
+        }
+        a = std::exchange(b, a + b);
+    }
+    std::cout << "small: " << limit + 8 - failures << "/" << limit + 8 << " passed" << std::endl;
+    return failures == 0;
+}
+
+/* seconds per call (the minimum over a few batches, to filter out noise) */
+double time_call(const std::function<void()> &call)
+{
+    size_t batch = 1;
+    sec_t best(1e9);
+    for (int round = 0; round < 9; ++round)
+    {
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < batch; ++i)
+        {
+            call();
+        }
+        sec_t per_call = (std::chrono::steady_clock::now() - start) / static_cast<double>(batch);
+        best = std::min(best, per_call);
+        if (round == 0)
+        {
+            // about 50ms per batch
+            batch = std::max<size_t>(1, static_cast<size_t>(0.05 / std::max(per_call.count(), 1e-9)));
+        }
+    }
+    return best.count();
+}
+
+bool check_timing(const std::string &path, double threshold, bool update)
+{
+    num_t<u32> a32 = operand<u32>(4096, shape::random);
+    num_t<u32> b32 = operand<u32>(4096, shape::random);
+    num_t<u32> c32 = operand<u32>(1024, shape::random);
+    num_t<u8> a8 = operand<u8>(1 << 16, shape::random);
+    num_t<u8> b8 = operand<u8>(1 << 16, shape::random);
+    num_t<u64> x = operand<u64>(1 << 12, shape::random);
+    size_t sink = 0;
+    const std::vector<std::pair<std::string, std::function<void()>>> kernels {
+        { "add_4096", [&] { sink += (a32 + b32).value.size(); } },
+        { "mul_simple_1024", [&] { sink += big::product<big::simple::backend>(c32, c32).value.size(); } },
+        { "mul_karatsuba_4096", [&] { sink += big::product<big::karatsuba::backend>(a32, b32).value.size(); } },
+        { "mul_karatsuba_cutoff_4096", [&] { sink += big::product<big::karatsuba::cutoff_backend<>>(a32, b32).value.size(); } },
+        { "mul_fft_65536", [&] { sink += big::product<big::fft::backend>(a8, b8).value.size(); } },
+        { "decimal_4096", [&] { sink += big::decimal_blocks(x).size(); } },
+    };
+
+    std::map<std::string, double> baseline;
+    {
+        std::ifstream in(path);
+        std::string name;
+        double seconds;
+        while (in >> name >> seconds)
+        {
+            baseline[name] = seconds;
+        }
+    }
+    if (baseline.empty() && !update)
+    {
+        std::cout << "No timing baseline in " << path << " yet: writing this run's, nothing compared" << std::endl;
+        update = true;
+    }
+
+    bool ok = true;
+    std::map<std::string, double> measured;
+    for (const auto &[name, call] : kernels)
+    {
+        double seconds = time_call(call);
+        measured[name] = seconds;
+        auto it = baseline.find(name);
+        double ratio = it == baseline.end() ? 1 : seconds / it->second;
+        bool slow = !update && ratio > threshold;
+        std::cout << std::left << std::setw(28) << name << std::setw(14) << seconds << "x" << ratio
+            << (slow ? "  REGRESSED" : "") << std::endl;
+        ok = ok && !slow;
+    }
+    std::cerr << "(checksum " << sink << ")" << std::endl;
+
+    if (update)
+    {
+        std::ofstream out(path);
+        for (const auto &[name, seconds] : measured)
+        {
+            out << name << ' ' << seconds << '\n';
+        }
+        if (!out.flush())
+        {
+            std::cerr << "Cannot write the timing baseline to " << path << std::endl;
+            return false;
+        }
+        std::cout << "baseline written to " << path << std::endl;
+    }
+    return ok;
+}
+
+int main(int argc, char *argv[])
+{
+    bool kernels = false;
+    std::vector<number> indices;
+    std::vector<number> batch;
+    std::vector<number> leading;
+    bool small = false;
+    std::string timing;
+    double threshold = 1.25;
+    bool update = false;
+    auto usage = [&]
+    {
+        std::cerr << "Usage: " << argv[0] << " [--kernels] [--fib=N]... [--batch=N,N,...] [--leading=N,N,...] [--small] [--timing=FILE [--threshold=RATIO] [--update]]" << std::endl;
+        return 1;
+    };
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string_view arg(argv[i]);
+        std::string value(arg.substr(arg.find('=') + 1));
+        if (arg == "--kernels")
+        {
+            kernels = true;
+        }
+        else if (arg.starts_with("--fib="))
+        {
+            indices.emplace_back(value);
+        }
+        else if (arg.starts_with("--batch=") || arg.starts_with("--leading="))
+        {
+            std::vector<number> &list = arg.starts_with("--batch=") ? batch : leading;
+            for (size_t start = 0, end; start < value.size(); start = end + 1)
+            {
+                end = std::min(value.find(',', start), value.size());
+                list.emplace_back(value.substr(start, end - start));
+            }
+        }
+        else if (arg == "--small")
+        {
+            small = true;
+        }
+        else if (arg.starts_with("--timing="))
+        {
+            timing = value;
+        }
+        else if (arg.starts_with("--threshold="))
+        {
+            // (a ratio of 1 or less would flag every kernel)
+            if (!parse_option(value, threshold, std::nextafter(1., 2.), std::numeric_limits<double>::max()))
+            {
+                return usage();
+            }
+        }
+        else if (arg == "--update")
+        {
+            update = true;
+        }
+        else
+        {
+            return usage();
+        }
+    }
+
+    bool ok = true;
+    if (kernels)
+    {
+        ok = check_kernels() && ok;
+    }
+    for (const number &n : indices)
+    {
+        ok = check_fib(n) && ok;
+    }
+    if (!batch.empty())
+    {
+        ok = check_batch(batch) && ok;
+    }
+    if (!leading.empty())
+    {
+        ok = check_leading(leading) && ok;
+    }
+    if (small)
+    {
+        ok = check_small() && ok;
+    }
+    if (!timing.empty())
+    {
+        ok = check_timing(timing, threshold, update) && ok;
+    }
+    return ok ? 0 : 1;
+}
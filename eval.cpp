@@ -1,12 +1,26 @@
+#include <algorithm>
 #include <atomic>
+#include <cerrno>
 #include <chrono>
+#include <cmath>
+#include <cstring>
 #include <iostream>
 #include <iomanip>
 #include <optional>
+#include <string>
+#include <string_view>
 #include <thread>
-#include <pthread.h> /* for pthread_cancel */
+#include <utility>
+#include <vector>
+#include <pthread.h> /* for pthread_setschedparam */
+#include <poll.h>
+#include <sched.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
 
 #include "fib_base.h"
+#include "options.h"
 
 #ifndef LIMIT
 #define LIMIT 1.0
@@ -22,26 +36,70 @@ const sec_t nap(0.01);
 constexpr uint64_t first_mark = 92; // 93rd is the largest 64-bit fibonacci number
 constexpr uint64_t second_mark = 512; // 512th fibonacci number has 355 bits
 
-bool eval(number n, sec_t &runtime, number &result, const sec_t sleep_dur)
+constexpr unsigned boundary_repeat = 5; // runs on either side of the boundary found by bisection
+
+/* benchmark settings (the defaults time a single run, as in the video) */
+struct
+{
+    unsigned warmup = 0; // untimed runs before the samples
+    unsigned repeat = 1; // timed runs, summarised by their median and IQR
+    int cpu = -1;        // pin the process (and every run) to this CPU
+    bool fork = false;   // each run in a fresh process
+    bool bisect = false; // search for the boundary instead of sweeping
+    bool memory = false; // report the peak memory of each index
+    std::vector<number> indices; // only time these (no search)
+    std::string label;   // prefixed to every row (when comparing algorithms)
+} bench;
+
+/* high-water marks of a run, in bytes (see num/memory.h) */
+struct usage_t
+{
+    size_t allocated = 0;
+    size_t resident = 0;
+};
+
+/* the largest over the runs of the last eval */
+usage_t last_usage;
+
+usage_t measure_usage()
+{
+    return { big::memory::peak_allocated(), big::memory::peak_resident() };
+}
+
+/* whether real-time priority was granted (reported once, on the first run) */
+void report_fifo(int error)
+{
+    static bool reported = false;
+    if (!reported)
+    {
+        reported = true;
+        std::cerr << "SCHED_FIFO: " << (error ? std::string("not applied (") + std::strerror(error) + ")" : "applied") << std::endl;
+    }
+}
+
+/* one run of fibonacci(n) on its own thread, cancelled after soft_limit */
+bool sample_thread(number n, sec_t &runtime, number &result, usage_t &usage, const sec_t sleep_dur)
 {
     std::atomic<bool> done(false);
     std::atomic<sec_t> run_atomic;
-    std::atomic<bool> detached(false);
+    big::control control;
 
-    sched_param param { sched_get_priority_max(SCHED_FIFO) };
-    std::thread runner([&done, &detached, &run_atomic, &result, &n]
+    std::atomic<int> fifo_error(0);
+    big::memory::reset_peak();
+    std::thread runner([&done, &run_atomic, &result, &n, &fifo_error, &control]
             {
-                number input = n;
+                sched_param param { sched_get_priority_max(SCHED_FIFO) };
+                fifo_error = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
                 auto start = std::chrono::steady_clock::now();
-                result = fibonacci(n);
+                std::optional<number> out = fibonacci(n, control);
                 auto delta = std::chrono::steady_clock::now() - start;
-                if (n == input)
+                if (out)
                 {
+                    result = *std::move(out);
                     run_atomic = delta;
                     done = true;
                 }
             });
-    pthread_setschedparam(runner.native_handle(), SCHED_FIFO, &param);
 
     auto start = std::chrono::steady_clock::now();
     do
@@ -49,37 +107,320 @@ bool eval(number n, sec_t &runtime, number &result, const sec_t sleep_dur)
         if (done)
         {
             runner.join();
+            report_fifo(fifo_error);
             runtime = run_atomic;
+            usage = measure_usage();
             return true;
         }
         std::this_thread::sleep_for(sleep_dur);
     }
     while (std::chrono::steady_clock::now() - start < soft_limit);
     
-    // timeout (don't let this happen too much)
-    pthread_cancel(runner.native_handle());
-    runner.detach();
+    // timeout: the run stops at its next check (between exponent bits, or
+    // within the product it is in), so it neither keeps burning a core nor
+    // writes into result later
+    control.cancel();
+    runner.join();
     return false;
 }
 
-void print_result(number n, sec_t runtime, number result)
+bool write_all(int fd, const void *data, size_t size)
+{
+    const char *bytes = static_cast<const char *>(data);
+    while (size)
+    {
+        ssize_t written = write(fd, bytes, size);
+        if (written < 0 && errno != EINTR)
+        {
+            return false;
+        }
+        if (written > 0)
+        {
+            bytes += written;
+            size -= static_cast<size_t>(written);
+        }
+    }
+    return true;
+}
+
+/* reads exactly size bytes unless the deadline passes (or the writer dies) */
+bool read_all(int fd, void *data, size_t size, std::chrono::steady_clock::time_point deadline)
 {
+    char *bytes = static_cast<char *>(data);
+    while (size)
+    {
+        auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+        pollfd p { fd, POLLIN, 0 };
+        if (left.count() <= 0 || poll(&p, 1, static_cast<int>(left.count())) == 0)
+        {
+            return false;
+        }
+        ssize_t got = read(fd, bytes, size);
+        if (got == 0 || (got < 0 && errno != EINTR))
+        {
+            return false;
+        }
+        if (got > 0)
+        {
+            bytes += got;
+            size -= static_cast<size_t>(got);
+        }
+    }
+    return true;
+}
+
+/* one run of fibonacci(n) in a child process (whose runtime and result come
+ * back through a pipe), killed after soft_limit
+ */
+bool sample_process(number n, sec_t &runtime, number &result, usage_t &usage)
+{
+    int fds[2];
+    if (pipe(fds) != 0)
+    {
+        return false;
+    }
+    pid_t child = fork();
+    if (child < 0)
+    {
+        close(fds[0]);
+        close(fds[1]);
+        return false;
+    }
+    if (child == 0)
+    {
+        close(fds[0]);
+        sched_param param { sched_get_priority_max(SCHED_FIFO) };
+        int fifo_error = sched_setscheduler(0, SCHED_FIFO, &param) ? errno : 0;
+        big::memory::reset_peak();
+        auto start = std::chrono::steady_clock::now();
+        number out = fibonacci(n);
+        double seconds = sec_t(std::chrono::steady_clock::now() - start).count();
+        usage_t child_usage = measure_usage();
+        size_t size = out.value.size();
+        bool ok = write_all(fds[1], &fifo_error, sizeof fifo_error)
+            && write_all(fds[1], &seconds, sizeof seconds)
+            && write_all(fds[1], &child_usage, sizeof child_usage)
+            && write_all(fds[1], &size, sizeof size)
+            && write_all(fds[1], out.value.data(), size * sizeof(std::uint64_t));
+        _exit(ok ? 0 : 1);
+    }
+    close(fds[1]);
+
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::duration_cast<std::chrono::steady_clock::duration>(soft_limit);
+    int fifo_error;
+    double seconds;
+    size_t size;
+    bool ok = read_all(fds[0], &fifo_error, sizeof fifo_error, deadline)
+        && read_all(fds[0], &seconds, sizeof seconds, deadline)
+        && read_all(fds[0], &usage, sizeof usage, deadline)
+        && read_all(fds[0], &size, sizeof size, deadline);
+    if (ok)
+    {
+        std::vector<std::uint64_t> limbs(size);
+        ok = read_all(fds[0], limbs.data(), size * sizeof(std::uint64_t), deadline);
+        result = number(std::move(limbs));
+        runtime = sec_t(seconds);
+        report_fifo(fifo_error);
+    }
+    close(fds[0]);
+    if (!ok)
+    {
+        kill(child, SIGKILL);
+    }
+    waitpid(child, nullptr, 0);
+    return ok;
+}
+
+/* value at quantile q of sorted samples (interpolating between neighbours) */
+sec_t quantile(const std::vector<sec_t> &sorted, double q)
+{
+    double pos = q * static_cast<double>(sorted.size() - 1);
+    size_t lo = static_cast<size_t>(pos);
+    size_t hi = std::min(lo + 1, sorted.size() - 1);
+    return sorted[lo] + (sorted[hi] - sorted[lo]) * (pos - static_cast<double>(lo));
+}
+
+/* times fibonacci(n) as set up in bench: runtime is the median of the
+ * samples, and iqr their interquartile range (false if any run times out,
+ * or if F_n cannot fit in the memory budget)
+ */
+bool eval(number n, sec_t &runtime, sec_t &iqr, number &result, const sec_t sleep_dur)
+{
+    if (!big::memory::fits(fibonacci_min_bytes(n)))
+    {
+        std::cerr << "F_" << n.str() << " does not fit in " << big::memory::format_size(big::memory::budget()) << std::endl;
+        return false;
+    }
+
+    std::vector<sec_t> samples;
+    last_usage = {};
+    for (unsigned i = 0; i < bench.warmup + bench.repeat; ++i)
+    {
+        sec_t run;
+        usage_t usage;
+        if (!(bench.fork ? sample_process(n, run, result, usage) : sample_thread(n, run, result, usage, sleep_dur)))
+        {
+            return false;
+        }
+        last_usage.allocated = std::max(last_usage.allocated, usage.allocated);
+        last_usage.resident = std::max(last_usage.resident, usage.resident);
+        if (i >= bench.warmup)
+        {
+            samples.push_back(run);
+        }
+    }
+    std::sort(samples.begin(), samples.end());
+    runtime = quantile(samples, 0.5);
+    iqr = quantile(samples, 0.75) - quantile(samples, 0.25);
+    return true;
+}
+
+void print_result(number n, sec_t runtime, sec_t iqr, number result)
+{
+    if (!bench.label.empty())
+    {
+        std::cout << bench.label << " :: ";
+    }
     std::cout << std::right << std::setw(15) << n.str() << " :: "
         << std::left << std::setw(20) << result.str() << " :: "
-        << std::setprecision(5) << runtime.count() << std::endl;
+        << std::setprecision(5) << runtime.count();
+    if (bench.repeat > 1)
+    {
+        std::cout << " :: " << std::setprecision(5) << iqr.count();
+    }
+    if (bench.memory)
+    {
+        std::cout << " :: " << last_usage.allocated << " :: " << last_usage.resident;
+    }
+    std::cout << std::endl;
 }
 
-int main(int, char *argv[])
+/* the largest n with a median runtime under hard_limit, above lo (which is
+ * assumed to be under it): brackets by doubling, then bisects down to 0.1%,
+ * and estimates a 95% confidence interval from the spread of the runtimes
+ * at the boundary
+ */
+uint64_t bisect(uint64_t lo, const char *name)
+{
+    sec_t runtime;
+    sec_t iqr;
+    number result;
+
+    // every index timed so far (one that timed out only bounds its runtime,
+    // so is not kept)
+    std::vector<std::pair<uint64_t, sec_t>> timed;
+    // returns whether n runs under hard_limit (printing its timing)
+    auto under = [&](uint64_t n)
+    {
+        if (!eval(n, runtime, iqr, result, nap))
+        {
+            return false;
+        }
+        print_result(n, runtime, iqr, result);
+        timed.emplace_back(n, runtime);
+        return runtime <= hard_limit;
+    };
+
+    under(lo);
+    uint64_t hi = lo << 1;
+    while (under(hi))
+    {
+        lo = hi;
+        hi <<= 1;
+    }
+    while (hi - lo > std::max<uint64_t>(1, lo >> 10))
+    {
+        uint64_t mid = lo + (hi - lo) / 2;
+        if (under(mid))
+        {
+            lo = mid;
+        }
+        else
+        {
+            hi = mid;
+        }
+    }
+
+    // runtime ~ n^exponent, between the largest index timed and the largest
+    // one at most half of it
+    std::sort(timed.begin(), timed.end());
+    auto below = std::find_if(timed.rbegin(), timed.rend(), [&](const auto &t) { return 2 * t.first <= timed.back().first; });
+    if (below == timed.rend() || below->second.count() <= 0)
+    {
+        std::cerr << name << " 95% confidence interval: unknown (too few indices timed)" << std::endl;
+        return lo;
+    }
+    double exponent = std::max(1., std::log(timed.back().second / below->second)
+        / std::log(static_cast<double>(timed.back().first) / static_cast<double>(below->first)));
+
+    // the spread at the boundary, from boundary_repeat runs (or more, with
+    // --repeat) on either side of it, since a single run has no spread
+    unsigned repeat = bench.repeat;
+    bench.repeat = std::max(repeat, boundary_repeat);
+    double sigma = 0; // relative to the runtime, averaged over both sides
+    unsigned sides = 0;
+    for (uint64_t n : { lo, hi })
+    {
+        if (eval(n, runtime, iqr, result, nap) && runtime.count() > 0)
+        {
+            std::cerr << name << " F_" << n << ": median " << runtime.count() << "s, IQR " << iqr.count()
+                << "s over " << bench.repeat << " runs" << std::endl;
+            // (sigma ~ IQR / 1.35)
+            sigma += iqr / 1.35 / runtime;
+            ++sides;
+        }
+    }
+    unsigned samples = bench.repeat;
+    bench.repeat = repeat;
+    if (!sides)
+    {
+        std::cerr << name << " 95% confidence interval: unknown (the boundary timed out)" << std::endl;
+        return lo;
+    }
+    sigma /= sides;
+
+    // the median of R samples has a standard error of about 1.25 sigma / sqrt(R),
+    // and a relative error e in the runtime moves the boundary by about e / exponent
+    double spread = 1.96 * 1.25 * sigma / std::sqrt(samples) / exponent;
+    double width = static_cast<double>(lo) * spread + static_cast<double>(hi - lo);
+    std::cerr << name << " 95% confidence interval: "
+        << static_cast<uint64_t>(std::max(0., static_cast<double>(lo) - width)) << " to "
+        << static_cast<uint64_t>(static_cast<double>(lo) + width)
+        << " (runtime ~ n^" << std::setprecision(3) << exponent << ")" << std::endl;
+    return lo;
+}
+
+/* searches for the largest index computed under hard_limit (or only times
+ * the indices in bench), reporting the final result under name
+ */
+int evaluate(const std::string &name)
 {
     number cur = 0;
     sec_t runtime;
+    sec_t iqr;
     number result;
     number best;
 
+    if (!bench.indices.empty())
+    {
+        for (const number &n : bench.indices)
+        {
+            if (eval(n, runtime, iqr, result, nap))
+            {
+                print_result(n, runtime, iqr, result);
+            }
+            else
+            {
+                std::cerr << "F_" << n.str() << " timed out" << std::endl;
+            }
+        }
+        return 0;
+    }
+
     // check correctness first (against linear implementation)
     {
         uint64_t a = 0, b = 1, tmp;
-        while (cur < first_mark && eval(cur, runtime, result, nap))
+        while (cur < first_mark && eval(cur, runtime, iqr, result, nap))
         {
             if (result != a)
             {
@@ -89,7 +430,7 @@ int main(int, char *argv[])
                 return -1;
             }
 
-            print_result(cur, runtime, result);
+            print_result(cur, runtime, iqr, result);
 
             if (runtime > soft_limit)
             {
@@ -114,7 +455,7 @@ int main(int, char *argv[])
             number aa(a);
             number bb(b);
             number tt;
-            while (cur <= second_mark && eval(cur, runtime, result, nap))
+            while (cur <= second_mark && eval(cur, runtime, iqr, result, nap))
             {
                 if (result != aa)
                 {
@@ -123,7 +464,7 @@ int main(int, char *argv[])
                         << "\tReceived: " << result.str(true) << "\n";
                     return -1;
                 }
-                print_result(cur, runtime, result);
+                print_result(cur, runtime, iqr, result);
 
                 if (runtime > soft_limit)
                 {
@@ -144,43 +485,178 @@ int main(int, char *argv[])
         }
     }
 
-    // search for upper bound
-    while (eval(cur, runtime, result, nap))
+    if (bench.bisect)
     {
-        cur += (cur >> 1) - (cur >> 3); // geometric growth
+        if (cur > second_mark)
+        {
+            best = bisect(second_mark, name.c_str());
+        }
     }
-
-    // now that we have an upper bound, generate ~1k evenly-spaced samples
-    number delta = cur >> 10;
-    if (delta == 0)
+    else
     {
-        delta = 1;
-    }
+        // search for upper bound
+        while (eval(cur, runtime, iqr, result, nap))
+        {
+            cur += (cur >> 1) - (cur >> 3); // geometric growth
+        }
+
+        // now that we have an upper bound, generate ~1k evenly-spaced samples
+        number delta = cur >> 10;
+        if (delta == 0)
+        {
+            delta = 1;
+        }
 
     
-    if (cur >= second_mark)
-    {
-        number n = second_mark + 1;
-        do
+        if (cur >= second_mark)
         {
-            bool success = eval(n, runtime, result, nap);
+            number n = second_mark + 1;
+            do
+            {
+                bool success = eval(n, runtime, iqr, result, nap);
+
+                if (!success || runtime > soft_limit)
+                {
+                    break;
+                }
+                print_result(n, runtime, iqr, result);
+                if (runtime <= hard_limit)
+                {
+                    best = n;
+                }
+                n += delta;
+            }
+            while (1);
+        }
+    }
+    std::cerr << name << " final result: " << best.str() << '\n';
 
-            if (!success || runtime > soft_limit)
+    number obtained = fibonacci(best);
+    std::cerr << "Fibonacci number obtained: " << obtained.str(obtained.value.size() < 10) << std::endl;
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+#ifdef FIB_REGISTRY
+    std::vector<const fib::algorithm *> algos; // evaluate each of these
+#endif
+    auto usage = [&]
+    {
+#ifdef FIB_REGISTRY
+        std::cerr << "Usage: " << argv[0] << " --algo=NAME[,NAME...]|--all" << std::endl
+            << "Algorithms: " << fib::algorithm_names() << std::endl;
+#endif
+        std::cerr << "Usage: " << argv[0] << " [--warmup=RUNS] [--repeat=RUNS] [--cpu=CPU] [--fork] [--search=sweep|bisect] [--memory] [--max-memory=BYTES[K|M|G]] [--bench=INDEX[,INDEX...]]" << std::endl;
+        return 1;
+    };
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string_view arg(argv[i]);
+        std::string value(arg.substr(arg.find('=') + 1));
+        if (arg.starts_with("--warmup="))
+        {
+            if (!parse_option(value, bench.warmup, 0u, ~0u))
             {
-                break;
+                return usage();
             }
-            print_result(n, runtime, result);
-            if (runtime <= hard_limit)
+        }
+        else if (arg.starts_with("--repeat="))
+        {
+            if (!parse_option(value, bench.repeat, 1u, ~0u))
+            {
+                return usage();
+            }
+        }
+        else if (arg.starts_with("--cpu="))
+        {
+            if (!parse_option(value, bench.cpu, 0, CPU_SETSIZE - 1))
+            {
+                return usage();
+            }
+        }
+        else if (arg == "--fork")
+        {
+            bench.fork = true;
+        }
+        else if (arg == "--search=bisect")
+        {
+            bench.bisect = true;
+        }
+        else if (arg == "--search=sweep")
+        {
+            bench.bisect = false;
+        }
+        else if (arg == "--memory")
+        {
+            bench.memory = true;
+            big::memory::start_counting();
+        }
+        else if (arg.starts_with("--max-memory=") && big::memory::parse_size(value) > 0)
+        {
+            big::memory::budget() = big::memory::parse_size(value);
+            bench.memory = true;
+            big::memory::start_counting();
+        }
+        else if (arg.starts_with("--bench="))
+        {
+            for (size_t start = 0, end; start < value.size(); start = end + 1)
+            {
+                end = std::min(value.find(',', start), value.size());
+                bench.indices.emplace_back(value.substr(start, end - start));
+            }
+        }
+#ifdef FIB_REGISTRY
+        else if (arg.starts_with("--algo=") && !fib::find_algorithms(value).empty())
+        {
+            algos = fib::find_algorithms(value);
+        }
+        else if (arg == "--all")
+        {
+            algos.clear();
+            for (const fib::algorithm &algo : fib::algorithms())
             {
-                best = n;
+                algos.push_back(&algo);
             }
-            n += delta;
         }
-        while (1);
+#endif
+        else
+        {
+            return usage();
+        }
+    }
+#ifdef FIB_REGISTRY
+    if (algos.empty())
+    {
+        std::cerr << "Choose an algorithm with --algo=NAME (or --all): " << fib::algorithm_names() << std::endl;
+        return 1;
     }
-    std::cerr << argv[0] << " final result: " << best.str() << '\n';
+#endif
 
-    number obtained = fibonacci(best);
-    std::cerr << "Fibonacci number obtained: " << obtained.str(obtained.value.size() < 10) << std::endl;
+    if (bench.cpu >= 0)
+    {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(bench.cpu, &set);
+        if (sched_setaffinity(0, sizeof set, &set) != 0)
+        {
+            std::cerr << "CPU pinning: not applied (" << std::strerror(errno) << ")" << std::endl;
+        }
+    }
+
+#ifdef FIB_REGISTRY
+    // one after the other, in the same process
+    for (const fib::algorithm *algo : algos)
+    {
+        fib::select_algorithm(*algo);
+        bench.label = algos.size() > 1 ? algo->name : "";
+        if (int status = evaluate(std::string(argv[0]) + " (" + algo->name + ")"))
+        {
+            return status;
+        }
+    }
     return 0;
+#else
+    return evaluate(argv[0]);
+#endif
 }
@@ -0,0 +1,221 @@
+/* Computing many Fibonacci numbers at once
+ *
+ * Indices are visited in increasing order. With a power engine, each one is
+ * reached from the previous one by multiplying by step^delta, where the
+ * squarings of the step are computed once and shared by every index, and
+ * small deltas are walked with additions only. With a doubling engine, which
+ * scans the index from its top bit, the states of the leading bits an index
+ * shares with the previous one are reused, and only the rest is scanned
+ * (which saves little, as most of the work goes into the last bits), and
+ * small deltas are walked with additions as well.
+ */
+
+#ifndef __FIB_BATCH_H
+#define __FIB_BATCH_H
+
+#include "num/number.h"
+#include "fib/small.h"
+
+#include <algorithm>
+#include <numeric>
+#include <optional>
+#include <span>
+#include <vector>
+
+namespace fib
+{
+
+    using big::number;
+
+    /* deltas up to this are walked one step at a time (with additions) */
+    constexpr unsigned batch_walk = 32;
+
+    /* for any power engine (see fib/matrix.h and fib/golden.h) */
+    template<typename Engine>
+    inline std::vector<number> batch(std::span<const number>);
+
+    /* for any doubling engine (see fib/doubling.h and fib/lucas.h) */
+    template<typename Engine>
+    inline std::vector<number> batch_doubling(std::span<const number>);
+
+    /* for everything else: computes each distinct index once */
+    inline std::vector<number> batch_scalar(std::span<const number>, number (*)(number));
+
+    //////////////// IMPLEMENTATIONS ////////////////
+
+    inline std::vector<size_t> sorted_order(std::span<const number> ns)
+    {
+        std::vector<size_t> order(ns.size());
+        std::iota(order.begin(), order.end(), 0);
+        std::stable_sort(order.begin(), order.end(),
+                [&ns](size_t i, size_t j) { return ns[i] < ns[j]; });
+        return order;
+    }
+
+    template<typename Engine>
+    std::vector<number> batch(std::span<const number> ns)
+    {
+        using element_t = Engine::element_t;
+
+        std::vector<number> out(ns.size());
+
+        // squares[i] = step^(2^i)
+        std::vector<element_t> squares { Engine::step() };
+
+        // cur = step^prev
+        number prev = 0;
+        std::optional<element_t> cur;
+        const number *last = nullptr;
+
+        for (size_t i : sorted_order(ns))
+        {
+            const number &n = ns[i];
+            if (last && *last == n)
+            {
+                out[i] = out[last - ns.data()];
+                continue;
+            }
+            last = &n;
+            if (n.value.empty())
+            {
+                continue;
+            }
+
+            number delta = n - prev;
+            if (delta <= batch_walk)
+            {
+                for (; delta > 0; --delta)
+                {
+                    cur = cur ? cur->next() : Engine::step();
+                }
+            }
+            else
+            {
+                size_t bits = delta.bit_width();
+                while (squares.size() < bits)
+                {
+                    squares.push_back(Engine::sqr(squares.back()));
+                }
+                for (size_t bit = 0; bit < bits; ++bit)
+                {
+                    if (delta.bit(bit))
+                    {
+                        cur = cur ? Engine::mul(*cur, squares[bit]) : squares[bit];
+                    }
+                }
+            }
+            prev = n;
+            out[i] = Engine::value(*cur);
+        }
+        return out;
+    }
+
+    template<typename Engine>
+    std::vector<number> batch_doubling(std::span<const number> ns)
+    {
+        using state_t = Engine::state_t;
+
+        std::vector<number> out(ns.size());
+        std::vector<size_t> order = sorted_order(ns);
+
+        // states[j] = the state for the top j bits of scanned
+        std::vector<state_t> states;
+        const number *scanned = nullptr;
+        // the state for prev itself, kept when the next index is close enough
+        // to walk to
+        std::optional<state_t> cur;
+        number prev = 0;
+
+        for (size_t pos = 0; pos < order.size(); ++pos)
+        {
+            size_t i = order[pos];
+            const number &n = ns[i];
+            if (pos > 0 && ns[order[pos - 1]] == n)
+            {
+                out[i] = out[order[pos - 1]];
+                continue;
+            }
+            const number *following = nullptr;
+            for (size_t next = pos + 1; next < order.size() && !following; ++next)
+            {
+                if (ns[order[next]] != n)
+                {
+                    following = &ns[order[next]];
+                }
+            }
+            bool keep = following && *following - n <= batch_walk;
+
+            if (cur && n - prev <= batch_walk)
+            {
+                for (number delta = n - prev; delta > 0; --delta)
+                {
+                    cur = Engine::advance(*cur);
+                }
+                out[i] = Engine::value(*cur);
+                prev = n;
+                continue;
+            }
+            cur.reset();
+            if (std::optional<number> small = small_fibonacci(n))
+            {
+                out[i] = *std::move(small);
+                continue;
+            }
+
+            // keep the states of the leading bits shared with scanned
+            size_t width = n.bit_width();
+            size_t shared = 0;
+            if (scanned)
+            {
+                size_t scanned_width = scanned->bit_width();
+                while (shared + 1 < std::min(width, scanned_width)
+                        && n.bit(width - 1 - shared) == scanned->bit(scanned_width - 1 - shared))
+                {
+                    ++shared;
+                }
+            }
+            states.resize(std::min(states.size(), shared + 1));
+            if (states.empty())
+            {
+                states.push_back(Engine::start());
+            }
+            while (states.size() < width)
+            {
+                states.push_back(Engine::next(states.back(), n.bit(width - states.size())));
+            }
+            scanned = &n;
+
+            if (keep)
+            {
+                cur = Engine::next(states.back(), n.bit(0));
+                out[i] = Engine::value(*cur);
+            }
+            else
+            {
+                out[i] = Engine::value(states.back(), n.bit(0));
+            }
+            prev = n;
+        }
+        return out;
+    }
+
+    std::vector<number> batch_scalar(std::span<const number> ns, number (*fibonacci)(number))
+    {
+        std::vector<number> out(ns.size());
+        const number *last = nullptr;
+        for (size_t i : sorted_order(ns))
+        {
+            if (last && *last == ns[i])
+            {
+                out[i] = out[last - ns.data()];
+                continue;
+            }
+            last = &ns[i];
+            out[i] = fibonacci(ns[i]);
+        }
+        return out;
+    }
+
+} // namespace fib
+
+#endif//__FIB_BATCH_H
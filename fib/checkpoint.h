@@ -0,0 +1,366 @@
+/* On-disk checkpoints of the exponent loops
+ *
+ * File layout (native endianness; version 1):
+ *   magic "FIBCKPT\0"  u32 version
+ *   u64 tag length     tag (type of the loop that wrote it)
+ *   index              u64 bits left to scan
+ *   loop state         (each num_t is u64 digit count, then the raw digits)
+ *
+ * Checkpoints are written to "<path>.tmp", synced to disk, and only then
+ * renamed over <path>, so a killed process (or a crash, or a full disk)
+ * always leaves a complete checkpoint behind; failures are reported on
+ * stderr, and the run goes on.
+ */
+
+#ifndef __FIB_CHECKPOINT_H
+#define __FIB_CHECKPOINT_H
+
+#include "num/number.h"
+#include "num/signed.h"
+
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <typeinfo>
+
+#include <unistd.h>
+
+namespace fib
+{
+
+    using big::UInt;
+    using big::number;
+
+    constexpr char checkpoint_magic[8] = "FIBCKPT";
+    constexpr std::uint32_t checkpoint_version = 1;
+
+    /* process-wide settings (set by the harness before calling fibonacci) */
+    struct checkpoint_config
+    {
+        using sec_t = std::chrono::duration<double>;
+
+        std::string path; // no checkpoints when empty
+        sec_t interval { 60. };
+        bool resume = false;
+
+        std::chrono::steady_clock::time_point last_save = std::chrono::steady_clock::now();
+        std::optional<size_t> resumed; // bits left when the run was resumed
+
+        bool due() const { return !path.empty() && std::chrono::steady_clock::now() - last_save >= interval; }
+    };
+
+    inline checkpoint_config checkpoint;
+
+    class checkpoint_writer
+    {
+        std::FILE *file;
+        std::vector<char> buffer;
+        bool good;
+        int error = 0; // errno of the first failure
+
+    public:
+        explicit inline checkpoint_writer(const std::string &);
+        inline ~checkpoint_writer();
+
+        /* flushes the file to disk and closes it, and returns whether
+         * everything was written
+         */
+        inline bool close();
+        /* why not (if close returned false) */
+        std::string reason() const { return std::strerror(error); }
+
+        inline void bytes(const void *, size_t);
+        template<typename V>
+            requires std::is_trivially_copyable_v<V>
+        void pod(const V &x) { bytes(&x, sizeof(V)); }
+    };
+
+    class checkpoint_reader
+    {
+        std::FILE *file;
+        bool good;
+        size_t left; // bytes not read yet
+
+    public:
+        explicit inline checkpoint_reader(const std::string &);
+        inline ~checkpoint_reader();
+
+        bool ok() const { return good; }
+        /* whether count more items of each bytes are left in the file (so
+         * that sizes read from it are bounded before anything is allocated);
+         * if not, the reader fails
+         */
+        inline bool has(std::uint64_t count, size_t each);
+        /* fails the reader (for values that read back but make no sense) */
+        void fail() { good = false; }
+
+        inline void bytes(void *, size_t);
+        template<typename V>
+            requires std::is_trivially_copyable_v<V>
+        void pod(V &x) { bytes(&x, sizeof(V)); }
+    };
+
+    template<UInt T>
+    inline void save(checkpoint_writer &, const big::num_t<T> &);
+    template<UInt T>
+    inline void load(checkpoint_reader &, big::num_t<T> &);
+    template<UInt T>
+    inline void save(checkpoint_writer &, const big::sint_t<T> &);
+    template<UInt T>
+    inline void load(checkpoint_reader &, big::sint_t<T> &);
+    template<typename E>
+    inline void save(checkpoint_writer &, const std::optional<E> &);
+    template<typename E>
+    inline void load(checkpoint_reader &, std::optional<E> &);
+    inline void save(checkpoint_writer &w, bool x) { w.pod(x); }
+    inline void load(checkpoint_reader &, bool &);
+
+    /* writes the state of the loop identified by tag, if a checkpoint is due */
+    template<typename... S>
+    inline void periodic_save(const std::type_info &tag, const number &n, size_t bits_left, const S &...);
+
+    /* loads the state of the loop identified by tag, if resuming and the
+     * checkpoint matches, with between min_left and the given bits_left
+     * bits left to scan (otherwise leaves everything untouched)
+     */
+    template<typename... S>
+    inline bool restore(const std::type_info &tag, const number &n, size_t &bits_left, size_t min_left, S &...);
+
+    //////////////// IMPLEMENTATIONS ////////////////
+
+    checkpoint_writer::checkpoint_writer(const std::string &path)
+        : file(std::fopen(path.c_str(), "wb"))
+        , buffer(1 << 20)
+        , good(file)
+        , error(file ? 0 : errno)
+    {
+        if (file)
+        {
+            // large digit arrays bypass the buffer anyway
+            std::setvbuf(file, buffer.data(), _IOFBF, buffer.size());
+        }
+    }
+    checkpoint_writer::~checkpoint_writer()
+    {
+        close();
+    }
+    bool checkpoint_writer::close()
+    {
+        if (file)
+        {
+            // (the data must be on disk before the rename makes it the checkpoint)
+            bool synced = std::fflush(file) == 0 && fsync(fileno(file)) == 0;
+            error = good && !synced ? errno : error;
+            good = good && synced;
+            bool closed = std::fclose(file) == 0;
+            error = good && !closed ? errno : error;
+            good = good && closed;
+            file = nullptr;
+        }
+        return good;
+    }
+    void checkpoint_writer::bytes(const void *data, size_t size)
+    {
+        if (good && std::fwrite(data, 1, size, file) != size)
+        {
+            good = false;
+            error = errno;
+        }
+    }
+
+    checkpoint_reader::checkpoint_reader(const std::string &path)
+        : file(std::fopen(path.c_str(), "rb"))
+        , good(file)
+        , left(0)
+    {
+        long end = -1;
+        good = good && std::fseek(file, 0, SEEK_END) == 0 && (end = std::ftell(file)) >= 0 && std::fseek(file, 0, SEEK_SET) == 0;
+        left = good ? static_cast<size_t>(end) : 0;
+    }
+    checkpoint_reader::~checkpoint_reader()
+    {
+        if (file)
+        {
+            std::fclose(file);
+        }
+    }
+    bool checkpoint_reader::has(std::uint64_t count, size_t each)
+    {
+        good = good && count <= left / each;
+        return good;
+    }
+    void checkpoint_reader::bytes(void *data, size_t size)
+    {
+        good = good && size <= left && std::fread(data, 1, size, file) == size;
+        left -= good ? size : 0;
+    }
+
+    template<UInt T>
+    void save(checkpoint_writer &w, const big::num_t<T> &x)
+    {
+        w.pod(static_cast<std::uint64_t>(x.value.size()));
+        w.bytes(x.value.data(), x.value.size() * sizeof(T));
+    }
+    template<UInt T>
+    void load(checkpoint_reader &r, big::num_t<T> &x)
+    {
+        std::uint64_t size = 0;
+        r.pod(size);
+        if (!r.has(size, sizeof(T)))
+        {
+            return;
+        }
+        x.value.resize(size);
+        r.bytes(x.value.data(), size * sizeof(T));
+        x.full_reduce();
+    }
+
+    template<UInt T>
+    void save(checkpoint_writer &w, const big::sint_t<T> &x)
+    {
+        w.pod(x.sign);
+        save(w, x.abs);
+    }
+    template<UInt T>
+    void load(checkpoint_reader &r, big::sint_t<T> &x)
+    {
+        using sign_t = big::sint_t<T>::sign_t;
+        using raw_t = std::underlying_type_t<sign_t>;
+        raw_t sign = 0;
+        r.pod(sign);
+        if (sign < static_cast<raw_t>(sign_t::ZERO) || sign > static_cast<raw_t>(sign_t::NEG))
+        {
+            // (not one of the enumerators)
+            r.fail();
+            return;
+        }
+        x.sign = static_cast<sign_t>(sign);
+        load(r, x.abs);
+    }
+
+    void load(checkpoint_reader &r, bool &x)
+    {
+        // (any other byte would not be a bool)
+        std::uint8_t byte = 0;
+        r.pod(byte);
+        if (byte > 1)
+        {
+            r.fail();
+        }
+        x = byte == 1;
+    }
+
+    template<typename E>
+    void save(checkpoint_writer &w, const std::optional<E> &x)
+    {
+        save(w, x.has_value());
+        if (x)
+        {
+            save(w, *x);
+        }
+    }
+    template<typename E>
+    void load(checkpoint_reader &r, std::optional<E> &x)
+    {
+        bool present = false;
+        load(r, present);
+        if (present)
+        {
+            x.emplace();
+            load(r, *x);
+        }
+        else
+        {
+            x.reset();
+        }
+    }
+
+    template<typename... S>
+    void periodic_save(const std::type_info &tag, const number &n, size_t bits_left, const S &...state)
+    {
+        if (!checkpoint.due())
+        {
+            return;
+        }
+
+        std::string tmp = checkpoint.path + ".tmp";
+        checkpoint_writer w(tmp);
+        w.bytes(checkpoint_magic, sizeof(checkpoint_magic));
+        w.pod(checkpoint_version);
+        std::uint64_t tag_len = std::strlen(tag.name());
+        w.pod(tag_len);
+        w.bytes(tag.name(), tag_len);
+        save(w, n);
+        w.pod(static_cast<std::uint64_t>(bits_left));
+        (save(w, state), ...);
+
+        // (the previous checkpoint stays until this one is complete)
+        if (!w.close())
+        {
+            std::cerr << "Could not write checkpoint " << tmp << ": " << w.reason() << std::endl;
+            std::remove(tmp.c_str());
+        }
+        else if (std::rename(tmp.c_str(), checkpoint.path.c_str()) != 0)
+        {
+            std::cerr << "Could not replace checkpoint " << checkpoint.path << ": " << std::strerror(errno) << std::endl;
+            std::remove(tmp.c_str());
+        }
+        checkpoint.last_save = std::chrono::steady_clock::now();
+    }
+
+    template<typename... S>
+    bool restore(const std::type_info &tag, const number &n, size_t &bits_left, size_t min_left, S &...state)
+    {
+        if (!checkpoint.resume || checkpoint.path.empty())
+        {
+            return false;
+        }
+
+        checkpoint_reader r(checkpoint.path);
+
+        char magic[sizeof(checkpoint_magic)] = {};
+        std::uint32_t version = 0;
+        r.bytes(magic, sizeof(magic));
+        r.pod(version);
+        if (!r.ok() || std::memcmp(magic, checkpoint_magic, sizeof(magic)) || version != checkpoint_version)
+        {
+            return false;
+        }
+
+        std::uint64_t tag_len = 0;
+        r.pod(tag_len);
+        std::string saved_tag(r.has(tag_len, 1) ? tag_len : 0, '\0');
+        r.bytes(saved_tag.data(), saved_tag.size());
+        number saved_n;
+        load(r, saved_n);
+        if (!r.ok() || saved_tag != tag.name() || saved_n != n)
+        {
+            return false;
+        }
+
+        // don't touch the caller's state unless the whole checkpoint reads back
+        std::uint64_t saved_bits = 0;
+        std::tuple<S...> saved;
+        r.pod(saved_bits);
+        std::apply([&r](auto &...s) { (load(r, s), ...); }, saved);
+        // (the loops count on it, e.g. to stop at zero)
+        if (!r.ok() || saved_bits < min_left || saved_bits > bits_left)
+        {
+            return false;
+        }
+
+        bits_left = saved_bits;
+        std::tie(state...) = std::move(saved);
+        checkpoint.resumed = bits_left;
+        return true;
+    }
+
+} // namespace fib
+
+#endif//__FIB_CHECKPOINT_H
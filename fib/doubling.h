@@ -0,0 +1,123 @@
+/* Fast-doubling engine
+ *
+ * F(2k)   = F(k) * (2F(k+1) - F(k))
+ * F(2k+1) = F(k)^2 + F(k+1)^2
+ *
+ * Scans the index from its most significant bit, so each bit costs
+ * three multiplications (two of which are squarings).
+ */
+
+#ifndef __FIB_DOUBLING_H
+#define __FIB_DOUBLING_H
+
+#include "num/number.h"
+#include "fib/checkpoint.h"
+#include "fib/small.h"
+
+namespace fib
+{
+
+    using big::UInt;
+    using big::number;
+    using big::product;
+    using big::square;
+
+    template<UInt T, typename Mul>
+    struct doubling_engine
+    {
+        using num = big::num_t<T>;
+
+        /* (F(k), F(k+1)) */
+        struct state_t
+        {
+            num a;
+            num b;
+        };
+
+        static inline number fibonacci(number);
+
+        /* the state for k = 0 */
+        static inline state_t start();
+        /* from the state for k to the one for 2k + bit */
+        static inline state_t next(const state_t &, bool bit);
+        /* F(2k + bit) */
+        static inline number value(const state_t &, bool bit);
+        /* from the state for k to the one for k + 1 (with additions only) */
+        static inline state_t advance(const state_t &);
+        /* F(k) */
+        static inline number value(const state_t &);
+    };
+
+    //////////////// IMPLEMENTATIONS ////////////////
+
+    template<UInt T, typename Mul>
+    number doubling_engine<T, Mul>::fibonacci(number n)
+    {
+        if (std::optional<number> small = small_fibonacci(n))
+        {
+            return *std::move(small);
+        }
+
+        // for k, the prefix of n scanned so far
+        state_t s = start();
+        size_t bit = n.bit_width();
+        restore(typeid(doubling_engine), n, bit, 1, s.a, s.b);
+        while (bit-- > 1)
+        {
+            s = next(s, n.bit(bit));
+            if (big::next_bit(n.bit_width() - bit, n.bit_width()))
+            {
+                break;
+            }
+            periodic_save(typeid(doubling_engine), n, bit, s.a, s.b);
+        }
+        return value(s, n.bit(0));
+    }
+
+    template<UInt T, typename Mul>
+    doubling_engine<T, Mul>::state_t doubling_engine<T, Mul>::start()
+    {
+        return { num(0), num(1) };
+    }
+
+    template<UInt T, typename Mul>
+    doubling_engine<T, Mul>::state_t doubling_engine<T, Mul>::next(const state_t &s, bool bit)
+    {
+        num c = product<Mul>(s.a, (s.b << 1) - s.a);
+        num d = square<Mul>(s.a) + square<Mul>(s.b);
+        if (bit)
+        {
+            num e = c + d;
+            return { std::move(d), std::move(e) };
+        }
+        return { std::move(c), std::move(d) };
+    }
+
+    template<UInt T, typename Mul>
+    number doubling_engine<T, Mul>::value(const state_t &s, bool bit)
+    {
+        if (bit)
+        {
+            // last bit only needs F(2k+1)
+            return static_cast<number>(square<Mul>(s.a) + square<Mul>(s.b));
+        }
+        // ... or F(2k)
+        return static_cast<number>(product<Mul>(s.a, (s.b << 1) - s.a));
+    }
+
+    template<UInt T, typename Mul>
+    doubling_engine<T, Mul>::state_t doubling_engine<T, Mul>::advance(const state_t &s)
+    {
+        num c = s.a + s.b;
+        return { s.b, std::move(c) };
+    }
+
+    template<UInt T, typename Mul>
+    number doubling_engine<T, Mul>::value(const state_t &s)
+    {
+        return static_cast<number>(s.a);
+    }
+
+} // namespace fib
+
+#endif//__FIB_DOUBLING_H
@@ -0,0 +1,116 @@
+/* Arithmetic in the golden-ratio ring Z[phi] (where phi^2 = phi + 1)
+ *
+ * phi^k = F(k-1) + F(k) phi, so F(n) can be read off phi^n exactly
+ * (without any of the halving needed to work in Z[sqrt 5]).
+ */
+
+#ifndef __FIB_GOLDEN_H
+#define __FIB_GOLDEN_H
+
+#include "num/number.h"
+#include "fib/checkpoint.h"
+#include "fib/small.h"
+#include "fib/scan.h"
+
+namespace fib
+{
+
+    using big::UInt;
+    using big::number;
+    using big::product;
+    using big::square;
+
+    /* a + b phi
+     *
+     * norm is a^2 + ab - b^2 when known to be a unit (+1 or -1), and 0 otherwise;
+     * the only units with nonnegative coefficients are powers of phi
+     */
+    template<UInt T>
+    struct zphi_t
+    {
+        big::num_t<T> a, b;
+        int norm = 0;
+
+        static zphi_t phi() { return { 0, 1, -1 }; }
+
+        /* multiplies by phi (additions only) */
+        zphi_t next() const { return { b, a + b, -norm }; }
+    };
+
+    template<UInt T>
+    inline void save(checkpoint_writer &w, const zphi_t<T> &x) { save(w, x.a); save(w, x.b); w.pod(x.norm); }
+    template<UInt T>
+    inline void load(checkpoint_reader &r, zphi_t<T> &x) { load(r, x.a); load(r, x.b); r.pod(x.norm); }
+
+    template<UInt T, typename Mul, scan_t Scan=scan_t::lsb_first>
+    struct golden_engine
+    {
+        using element_t = zphi_t<T>;
+
+        static element_t step() { return element_t::phi(); }
+        /* F(k), given phi^k */
+        static number value(const element_t &x) { return static_cast<number>(x.b); }
+
+        static inline element_t mul(const element_t &, const element_t &);
+        static inline element_t sqr(const element_t &);
+        static inline number fibonacci(number);
+    };
+
+    //////////////// IMPLEMENTATIONS ////////////////
+
+    /* (a + b phi)(c + d phi) = (ac + bd) + ((a + b)(c + d) - ac) phi
+     * 3 multiplications
+     */
+    template<UInt T, typename Mul, scan_t Scan>
+    golden_engine<T, Mul, Scan>::element_t golden_engine<T, Mul, Scan>::mul(const element_t &l, const element_t &r)
+    {
+        auto ac = product<Mul>(l.a, r.a);
+        auto bd = product<Mul>(l.b, r.b);
+        auto cross = product<Mul>(l.a + l.b, r.a + r.b);
+        return { ac + bd, cross - ac, l.norm * r.norm };
+    }
+
+    /* (a + b phi)^2 = (a^2 + b^2) + (2ab + b^2) phi
+     *
+     * for units, a^2 = norm - ab + b^2, so this is
+     *   (2b^2 - ab + norm) + (2ab + b^2) phi
+     * 2 multiplications (3 squarings for non-units)
+     */
+    template<UInt T, typename Mul, scan_t Scan>
+    golden_engine<T, Mul, Scan>::element_t golden_engine<T, Mul, Scan>::sqr(const element_t &x)
+    {
+        if (x.norm == 0)
+        {
+            auto aa = square<Mul>(x.a);
+            auto bb = square<Mul>(x.b);
+            auto ss = square<Mul>(x.a + x.b);
+            return { aa + bb, ss - aa, 0 };
+        }
+
+        auto ab = product<Mul>(x.a, x.b);
+        auto bb = square<Mul>(x.b);
+        auto a = (bb << 1) - ab; // b >= a for positive powers of phi
+        if (x.norm > 0)
+        {
+            ++a;
+        }
+        else
+        {
+            --a;
+        }
+        return { std::move(a), (ab << 1) + bb, 1 };
+    }
+
+    template<UInt T, typename Mul, scan_t Scan>
+    number golden_engine<T, Mul, Scan>::fibonacci(number n)
+    {
+        if (std::optional<number> small = small_fibonacci(n))
+        {
+            return *std::move(small);
+        }
+        return value(power<Scan, golden_engine>(step(), n));
+    }
+
+} // namespace fib
+
+#endif//__FIB_GOLDEN_H
@@ -0,0 +1,334 @@
+/* Leading decimal digits of F(n), without computing F(n)
+ *
+ * By Binet's formula, ln F(n) = n ln(phi) - ln(sqrt 5) up to a relative
+ * error of phi^(-2n), so the digits and the exponent of F(n) come from
+ * ln F(n) = e ln(10) + r, with 0 <= r < ln(10), as exp(r) * 10^e.
+ *
+ * Everything is computed in fixed point, with enough fractional bits to
+ * absorb the bits of n, the digits asked for, and the rounding errors. The
+ * logarithms and the exponential are series of rational terms, summed by
+ * binary splitting (see split), so they cost a few products per level of
+ * the split rather than a pass over the precision per term. Where that
+ * is still more than computing F(n), the digits come from F(n) instead.
+ */
+
+#ifndef __FIB_LEADING_H
+#define __FIB_LEADING_H
+
+#include "num/number.h"
+#include "num/mulnum_karatsuba.h"
+#include "num/mulnum_fft.h"
+#include "num/decimal.h"
+#include "num/signed.h"
+#include "fib/doubling.h"
+#include "fib/modular.h"
+
+#include <bit>
+#include <cmath>
+#include <string>
+
+namespace fib
+{
+
+    using big::number;
+
+    /* F(n) ~ digits[0].digits[1..] * 10^exponent */
+    struct scientific
+    {
+        std::string digits;
+        number exponent;
+        bool exact = false; // digits is all of F(n)
+
+        inline std::string str() const;
+    };
+
+    /* the leading k > 0 digits of F(n), in O(log n + k) precision */
+    inline scientific leading_digits(const number &n, size_t k);
+
+    /* indices below which computing F(n) itself is cheaper, per bit of
+     * precision the approximation would need (measured)
+     */
+    constexpr size_t leading_exact_ratio = 32;
+
+    //////////////// IMPLEMENTATIONS ////////////////
+
+    namespace fixed
+    {
+        using num = big::num_t<std::uint32_t>;
+        using sint = big::sint_t<std::uint32_t>;
+
+        /* Karatsuba, and FFT for the big products at the top of the series */
+        struct backend
+        {
+            static constexpr size_t fft_digits = 1 << 14; // (measured)
+
+            static num mul(const num &lhs, const num &rhs)
+            {
+                if (std::min(lhs.value.size(), rhs.value.size()) < fft_digits)
+                {
+                    return big::karatsuba::cutoff_backend<>::mul(lhs, rhs);
+                }
+                using byte_num = big::num_t<std::uint8_t>;
+                return static_cast<num>(big::fft::backend::mul(static_cast<byte_num>(lhs), static_cast<byte_num>(rhs)));
+            }
+            static num sqr(const num &x)
+            {
+                if (x.value.size() < fft_digits)
+                {
+                    return big::karatsuba::cutoff_backend<>::sqr(x);
+                }
+                return static_cast<num>(big::fft::backend::sqr(static_cast<big::num_t<std::uint8_t>>(x)));
+            }
+        };
+        using mul = backend;
+
+        /* x * d */
+        inline num mul_small(num x, std::uint32_t d)
+        {
+            std::uint64_t carry = 0;
+            for (std::uint32_t &digit : x.value)
+            {
+                std::uint64_t cur = static_cast<std::uint64_t>(digit) * d + carry;
+                digit = static_cast<std::uint32_t>(cur);
+                carry = cur >> 32;
+            }
+            if (carry)
+            {
+                x.value.push_back(static_cast<std::uint32_t>(carry));
+            }
+            x.full_reduce();
+            return x;
+        }
+
+        /* x / d, rounded down */
+        inline num div_small(num x, std::uint32_t d)
+        {
+            std::uint64_t rem = 0;
+            for (auto rit = x.value.rbegin(); rit != x.value.rend(); ++rit)
+            {
+                std::uint64_t cur = rem << 32 | *rit;
+                *rit = static_cast<std::uint32_t>(cur / d);
+                rem = cur % d;
+            }
+            x.full_reduce();
+            return x;
+        }
+
+        /* x / d, rounded down, for any d > 0 */
+        inline num divide(num x, num d)
+        {
+            // scaling both keeps the quotient, and brings x under barrett's 4^k
+            size_t width = d.bit_width();
+            if (x.bit_width() > 2 * width)
+            {
+                size_t shift = x.bit_width() - 2 * width;
+                x <<= shift;
+                d <<= shift;
+            }
+            return big::barrett<mul, std::uint32_t>(std::move(d)).divide(x);
+        }
+
+        /* x * y, both with `point` fractional bits */
+        inline num mul_fixed(const num &x, const num &y, size_t point)
+        {
+            return product<mul>(x, y) >> point;
+        }
+
+        /* 10^k */
+        inline num pow10(size_t k)
+        {
+            num out(1);
+            for (size_t bit = std::bit_width(k); bit-- > 0; )
+            {
+                out = square<mul>(out);
+                if (k >> bit & 1)
+                {
+                    out = mul_small(std::move(out), 10);
+                }
+            }
+            return out;
+        }
+
+        /* term i of a series is p(0) ... p(i) / (q(0) ... q(i) d(i)) */
+        struct term_t
+        {
+            sint p;
+            num q;
+            num d;
+        };
+
+        /* terms [a, b) of a series, relative to the terms before a: their
+         * sum is t / (q d), and the terms from b on pick up a factor p / q
+         */
+        struct split_t
+        {
+            sint p;
+            num q;
+            num d;
+            sint t;
+        };
+
+        /* binary splitting: only the last few products are big */
+        template<typename Term>
+        inline split_t split(const Term &term, size_t a, size_t b)
+        {
+            if (b - a == 1)
+            {
+                term_t leaf = term(a);
+                sint t = leaf.p;
+                return { std::move(leaf.p), std::move(leaf.q), std::move(leaf.d), std::move(t) };
+            }
+            size_t m = a + (b - a) / 2;
+            split_t l = split(term, a, m);
+            split_t r = split(term, m, b);
+            // t = t_l q_r d_r + p_l d_l t_r
+            sint t = product<mul>(l.t, sint(product<mul>(r.q, r.d)))
+                + product<mul>(product<mul>(l.p, sint(l.d)), r.t);
+            return {
+                product<mul>(l.p, r.p),
+                product<mul>(l.q, r.q),
+                product<mul>(l.d, r.d),
+                std::move(t),
+            };
+        }
+
+        /* the sum of terms [0, count) of a positive series, with `point`
+         * fractional bits
+         */
+        template<typename Term>
+        inline num series(const Term &term, size_t count, size_t point)
+        {
+            split_t s = split(term, 0, count);
+            return divide(s.t.abs << point, product<mul>(s.q, s.d));
+        }
+
+        /* 2 atanh(1/q) = ln((q + 1) / (q - 1)), with `point` fractional bits */
+        inline num atanh_inv(std::uint32_t q, size_t point)
+        {
+            // 2 sum 1 / ((2i + 1) q^(2i + 1)), to below 2^-point
+            size_t count = static_cast<size_t>(point / (2 * std::log2(static_cast<double>(q)))) + 2;
+            return series([q](size_t i) -> term_t
+                    {
+                        return { 1, i ? q * q : q, num(2 * i + 1) };
+                    }, count, point) << 1;
+        }
+
+        /* ln(phi) = asinh(1/2), with `point` fractional bits */
+        inline num ln_phi(size_t point)
+        {
+            // sum c_i / (2i + 1), where c_0 = 1/2 and c_i = -c_(i-1) (2i - 1) / (8i)
+            size_t count = point / 2 + 2;
+            return series([](size_t i) -> term_t
+                    {
+                        if (i == 0)
+                        {
+                            return { 1, 2, 1 };
+                        }
+                        return { sint(num(2 * i - 1), sint::sign_t::NEG), num(8 * i), num(2 * i + 1) };
+                    }, count, point);
+        }
+
+        /* exp(x) for 0 <= x < 4, with `point` fractional bits (and a few
+         * less correct ones)
+         */
+        inline num exp(const num &x, size_t point)
+        {
+            // exp(x) = exp(x_0) exp(x_1) ..., where x_j holds the fractional
+            // bits of x in [s_(j-1), s_j), with s_j = 2^(j + 3) (and x_0 the
+            // integer part too): u / 2^s with u < 2^(s/2), so each series
+            // needs about 2 point / s terms, of s-bit numbers
+            num out = num(1) << point;
+            size_t done = 0;
+            for (size_t s = 8; done < point; s <<= 1)
+            {
+                s = std::min(s, point);
+                num u = x >> (point - s);
+                if (done)
+                {
+                    u -= (x >> (point - done)) << (s - done);
+                }
+                done = s;
+                if (u.value.empty())
+                {
+                    continue;
+                }
+
+                // until u^i / (2^(s i) i!) < 2^-(point + 2)
+                double log_term = 0;
+                size_t count = 1;
+                for (; log_term > -static_cast<double>(point + 2); ++count)
+                {
+                    log_term += static_cast<double>(u.bit_width()) - static_cast<double>(s) - std::log2(static_cast<double>(count));
+                }
+                num term_exp = series([&u, s](size_t i) -> term_t
+                        {
+                            if (i == 0)
+                            {
+                                return { 1, 1, 1 };
+                            }
+                            return { u, num(i) << s, 1 };
+                        }, count, point);
+                out = mul_fixed(out, term_exp, point);
+            }
+            return out;
+        }
+    } // namespace fixed
+
+    std::string scientific::str() const
+    {
+        if (exact)
+        {
+            return digits;
+        }
+        std::string mantissa = digits.size() > 1 ? digits.substr(0, 1) + '.' + digits.substr(1) : digits;
+        return mantissa + "e+" + exponent.str(true);
+    }
+
+    scientific leading_digits(const number &n, size_t k)
+    {
+        using fixed::num;
+        using fixed::mul;
+
+        // fractional bits: the integer part of n ln(phi), then the digits,
+        // then guard bits for the truncations
+        size_t digit_bits = static_cast<size_t>(std::ceil(k * std::log2(10.)));
+        size_t point = n.bit_width() + digit_bits + 64;
+
+        // F(n) itself has about 0.694 n bits, and costs a few dozen products
+        // of that size (with its decimal expansion), against a few hundred
+        // of `point` bits for the series below: take the cheaper. Besides,
+        // unless n log10(phi) ~ n / 4.785 leaves some 20 digits to spare
+        // past the k asked for, the approximation (which ignores
+        // (-phi)^(-n) / sqrt 5, and is rounded down) would end in 9s where
+        // F(n)'s digits run out
+        if (n < 5 * k + 100 || n < leading_exact_ratio * point)
+        {
+            std::string all = big::decimal_string(doubling_engine<std::uint32_t, mul>::fibonacci(n));
+            scientific out { all.substr(0, k), number(all.size() - 1), all.size() <= k };
+            return out;
+        }
+
+        num ln2 = fixed::atanh_inv(3, point);
+        num ln5 = (ln2 << 1) + fixed::atanh_inv(9, point); // 5 = 4 * 5/4
+        num ln10 = ln2 + ln5;
+
+        // ln F(n) = n ln(phi) - ln(5) / 2 = e ln(10) + r
+        num r = product<mul>(static_cast<num>(n), fixed::ln_phi(point)) - (ln5 >> 1);
+        num e = barrett<mul, std::uint32_t>(ln10).divide(r);
+
+        // exp(r) in [1, 10), shifted to k digits
+        num lead = fixed::exp(r, point);
+        num scale = fixed::pow10(k - 1);
+        lead = product<mul>(lead, scale) >> point;
+        if (lead >= fixed::mul_small(scale, 10))
+        {
+            // rounded up to 10^k
+            lead = fixed::div_small(lead, 10);
+            ++e;
+        }
+        return { big::decimal_string(lead), static_cast<number>(e) };
+    }
+
+} // namespace fib
+
+#endif//__FIB_LEADING_H
@@ -0,0 +1,161 @@
+/* Lucas-number doubling engine
+ *
+ * F(2k)   = F(k) * L(k)
+ * L(2k)   = L(k)^2 - 2(-1)^k
+ * F(2k+1) = (F(2k) + L(2k)) / 2
+ * L(2k+1) = (5F(2k) + L(2k)) / 2
+ *
+ * Scans the index from its most significant bit, so each bit costs one
+ * product and one squaring (and no halving costs more than a shift).
+ */
+
+#ifndef __FIB_LUCAS_H
+#define __FIB_LUCAS_H
+
+#include "num/number.h"
+#include "fib/checkpoint.h"
+#include "fib/small.h"
+
+namespace fib
+{
+
+    using big::UInt;
+    using big::number;
+    using big::product;
+    using big::square;
+
+    template<UInt T, typename Mul>
+    struct lucas_engine
+    {
+        using num = big::num_t<T>;
+
+        /* (F(k), L(k)), and the parity of k */
+        struct state_t
+        {
+            num f;
+            num l;
+            bool odd;
+        };
+
+        static inline number fibonacci(number);
+
+        /* the state for k = 0 */
+        static inline state_t start();
+        /* from the state for k to the one for 2k + bit */
+        static inline state_t next(const state_t &, bool bit);
+        /* F(2k + bit) */
+        static inline number value(const state_t &, bool bit);
+        /* from the state for k to the one for k + 1 (with additions only) */
+        static inline state_t advance(const state_t &);
+        /* F(k) */
+        static inline number value(const state_t &);
+
+        /* L(2k) */
+        static inline num double_l(const state_t &);
+    };
+
+    //////////////// IMPLEMENTATIONS ////////////////
+
+    template<UInt T, typename Mul>
+    number lucas_engine<T, Mul>::fibonacci(number n)
+    {
+        if (std::optional<number> small = small_fibonacci(n))
+        {
+            return *std::move(small);
+        }
+
+        // for k, the prefix of n scanned so far (starting after its top bit)
+        state_t s { num(1), num(1), true };
+        size_t bit = n.bit_width() - 1;
+        restore(typeid(lucas_engine), n, bit, 0, s.f, s.l, s.odd);
+        if (bit == 0)
+        {
+            // (restored after the last bit)
+            return static_cast<number>(s.f);
+        }
+        while (bit-- > 1)
+        {
+            s = next(s, n.bit(bit));
+            if (big::next_bit(n.bit_width() - 1 - bit, n.bit_width() - 1))
+            {
+                break;
+            }
+            periodic_save(typeid(lucas_engine), n, bit, s.f, s.l, s.odd);
+        }
+        return value(s, n.bit(0));
+    }
+
+    template<UInt T, typename Mul>
+    lucas_engine<T, Mul>::state_t lucas_engine<T, Mul>::start()
+    {
+        return { num(0), num(2), false };
+    }
+
+    template<UInt T, typename Mul>
+    lucas_engine<T, Mul>::state_t lucas_engine<T, Mul>::next(const state_t &s, bool bit)
+    {
+        num f2 = product<Mul>(s.f, s.l);
+        num l2 = double_l(s);
+
+        if (bit)
+        {
+            num f = f2 + l2;
+            f >>= 1;
+            num l = (f2 << 2) + f2 + l2;
+            l >>= 1;
+            return { std::move(f), std::move(l), true };
+        }
+        return { std::move(f2), std::move(l2), false };
+    }
+
+    template<UInt T, typename Mul>
+    number lucas_engine<T, Mul>::value(const state_t &s, bool bit)
+    {
+        num f2 = product<Mul>(s.f, s.l);
+        if (!bit)
+        {
+            // last bit only needs F(2k)
+            return static_cast<number>(f2);
+        }
+        // ... or F(2k+1) = (F(2k) + L(2k)) / 2
+        num l2 = double_l(s);
+        f2 += l2;
+        f2 >>= 1;
+        return static_cast<number>(f2);
+    }
+
+    template<UInt T, typename Mul>
+    lucas_engine<T, Mul>::state_t lucas_engine<T, Mul>::advance(const state_t &s)
+    {
+        // F(k+1) = (F(k) + L(k)) / 2, L(k+1) = (5F(k) + L(k)) / 2
+        num f = s.f + s.l;
+        f >>= 1;
+        num l = (s.f << 2) + s.f + s.l;
+        l >>= 1;
+        return { std::move(f), std::move(l), !s.odd };
+    }
+
+    template<UInt T, typename Mul>
+    number lucas_engine<T, Mul>::value(const state_t &s)
+    {
+        return static_cast<number>(s.f);
+    }
+
+    template<UInt T, typename Mul>
+    lucas_engine<T, Mul>::num lucas_engine<T, Mul>::double_l(const state_t &s)
+    {
+        num l2 = square<Mul>(s.l);
+        if (s.odd)
+        {
+            l2 += 2;
+        }
+        else
+        {
+            l2 -= 2;
+        }
+        return l2;
+    }
+
+} // namespace fib
+
+#endif//__FIB_LUCAS_H
@@ -0,0 +1,221 @@
+/* Generic 2x2 matrix-power engine
+ *
+ * Templated on the limb type, the multiplication backend (any of the
+ * `backend`s in num/mulnum_*.h) and the matrix product scheme.
+ */
+
+#ifndef __FIB_MATRIX_H
+#define __FIB_MATRIX_H
+
+#include "num/number.h"
+#include "num/signed.h"
+#include "fib/checkpoint.h"
+#include "fib/small.h"
+#include "fib/scan.h"
+
+namespace fib
+{
+
+    using big::UInt;
+    using big::number;
+    using big::product;
+    using big::square;
+
+    template<typename E>
+    struct M2x2
+    {
+        E e00, e01, e10, e11;
+
+        static M2x2 step() { return { 0, 1, 1, 1 }; }
+        /* right-multiplies by the step matrix (additions only) */
+        M2x2 next() const { return { e01, e00 + e01, e11, e10 + e11 }; }
+    };
+
+    /* powers of the step matrix [[0, 1], [1, 1]] are symmetric, with
+     * e11 == e00 + e01, so only (e00, e01) == (F(k-1), F(k)) is stored
+     */
+    template<typename E>
+    struct S2x2
+    {
+        E e00, e01;
+
+        static S2x2 step() { return { 0, 1 }; }
+        /* right-multiplies by the step matrix (additions only) */
+        S2x2 next() const { return { e01, e00 + e01 }; }
+    };
+
+    template<typename E>
+    inline void save(checkpoint_writer &w, const M2x2<E> &m) { save(w, m.e00); save(w, m.e01); save(w, m.e10); save(w, m.e11); }
+    template<typename E>
+    inline void load(checkpoint_reader &r, M2x2<E> &m) { load(r, m.e00); load(r, m.e01); load(r, m.e10); load(r, m.e11); }
+    template<typename E>
+    inline void save(checkpoint_writer &w, const S2x2<E> &m) { save(w, m.e00); save(w, m.e01); }
+    template<typename E>
+    inline void load(checkpoint_reader &r, S2x2<E> &m) { load(r, m.e00); load(r, m.e01); }
+
+    /* grade-school product: 8 multiplications, 4 additions */
+    struct naive
+    {
+        template<UInt T>
+        using matrix = M2x2<big::num_t<T>>;
+
+        template<typename Mul, typename E>
+        static inline M2x2<E> mul(const M2x2<E> &, const M2x2<E> &);
+        template<typename Mul, typename E>
+        static M2x2<E> sqr(const M2x2<E> &m) { return mul<Mul>(m, m); }
+    };
+
+    /* Strassen: 7 multiplications, 18 additions */
+    struct strassen
+    {
+        template<UInt T>
+        using matrix = M2x2<big::sint_t<T>>;
+
+        template<typename Mul, typename E>
+        static inline M2x2<E> mul(const M2x2<E> &, const M2x2<E> &);
+        template<typename Mul, typename E>
+        static M2x2<E> sqr(const M2x2<E> &m) { return mul<Mul>(m, m); }
+    };
+
+    /* Winograd's variant of Strassen: 7 multiplications, 15 additions */
+    struct winograd
+    {
+        template<UInt T>
+        using matrix = M2x2<big::sint_t<T>>;
+
+        template<typename Mul, typename E>
+        static inline M2x2<E> mul(const M2x2<E> &, const M2x2<E> &);
+        template<typename Mul, typename E>
+        static M2x2<E> sqr(const M2x2<E> &m) { return mul<Mul>(m, m); }
+    };
+
+    /* only for powers of the step matrix:
+     * 3 multiplications (3 squarings when squaring)
+     */
+    struct symmetric
+    {
+        template<UInt T>
+        using matrix = S2x2<big::num_t<T>>;
+
+        template<typename Mul, typename E>
+        static inline S2x2<E> mul(const S2x2<E> &, const S2x2<E> &);
+        template<typename Mul, typename E>
+        static inline S2x2<E> sqr(const S2x2<E> &);
+    };
+
+    template<UInt T, typename Mul, typename Scheme=naive, scan_t Scan=scan_t::lsb_first>
+    struct matrix_engine
+    {
+        using matrix_t = Scheme::template matrix<T>;
+        using element_t = matrix_t;
+
+        static matrix_t step() { return matrix_t::step(); }
+        /* F(k), given step^k */
+        static number value(const matrix_t &m) { return static_cast<number>(m.e01); }
+
+        static inline matrix_t mul(const matrix_t &, const matrix_t &);
+        static inline matrix_t sqr(const matrix_t &);
+        static inline number fibonacci(number);
+    };
+
+    //////////////// IMPLEMENTATIONS ////////////////
+
+    template<typename Mul, typename E>
+    M2x2<E> naive::mul(const M2x2<E> &l, const M2x2<E> &r)
+    {
+        return {
+                product<Mul>(l.e00, r.e00) + product<Mul>(l.e01, r.e10),
+                product<Mul>(l.e00, r.e01) + product<Mul>(l.e01, r.e11),
+                product<Mul>(l.e10, r.e00) + product<Mul>(l.e11, r.e10),
+                product<Mul>(l.e10, r.e01) + product<Mul>(l.e11, r.e11) };
+    }
+
+    template<typename Mul, typename E>
+    M2x2<E> strassen::mul(const M2x2<E> &l, const M2x2<E> &r)
+    {
+        E m0 = product<Mul>(l.e00 + l.e11, r.e00 + r.e11);
+        E m1 = product<Mul>(l.e10 + l.e11, r.e00);
+        E m2 = product<Mul>(l.e00, r.e01 - r.e11);
+        E m3 = product<Mul>(l.e11, r.e10 - r.e00);
+        E m4 = product<Mul>(l.e00 + l.e01, r.e11);
+        E m5 = product<Mul>(l.e10 - l.e00, r.e00 + r.e01);
+        E m6 = product<Mul>(l.e01 - l.e11, r.e10 + r.e11);
+        return {
+                m0 + m3 - m4 + m6, m2 + m4,
+                m1 + m3, m0 - m1 + m2 + m5 };
+    }
+
+    template<typename Mul, typename E>
+    M2x2<E> winograd::mul(const M2x2<E> &l, const M2x2<E> &r)
+    {
+        E s1 = l.e10 + l.e11;
+        E s2 = s1 - l.e00;
+        E s3 = l.e00 - l.e10;
+        E s4 = l.e01 - s2;
+        E t1 = r.e01 - r.e00;
+        E t2 = r.e11 - t1;
+        E t3 = r.e11 - r.e01;
+        E t4 = t2 - r.e10;
+
+        E m1 = product<Mul>(l.e00, r.e00);
+        E m2 = product<Mul>(l.e01, r.e10);
+        E m3 = product<Mul>(s4, r.e11);
+        E m4 = product<Mul>(l.e11, t4);
+        E m5 = product<Mul>(s1, t1);
+        E m6 = product<Mul>(s2, t2);
+        E m7 = product<Mul>(s3, t3);
+
+        E u2 = m1 + m6;
+        E u3 = u2 + m7;
+        E u4 = u2 + m5;
+        return {
+                m1 + m2, u4 + m3,
+                u3 - m4, u3 + m5 };
+    }
+
+    template<typename Mul, typename E>
+    S2x2<E> symmetric::mul(const S2x2<E> &l, const S2x2<E> &r)
+    {
+        // F(m+n-1) = F(m-1)F(n-1) + F(m)F(n)
+        // F(m+n)   = F(m-1)F(n) + F(m)F(n-1) + F(m)F(n)
+        //          = (F(m-1) + F(m))(F(n-1) + F(n)) - F(m-1)F(n-1)
+        E p0 = product<Mul>(l.e00, r.e00);
+        E p1 = product<Mul>(l.e01, r.e01);
+        E p2 = product<Mul>(l.e00 + l.e01, r.e00 + r.e01);
+        return { p0 + p1, p2 - p0 };
+    }
+
+    template<typename Mul, typename E>
+    S2x2<E> symmetric::sqr(const S2x2<E> &m)
+    {
+        E p0 = square<Mul>(m.e00);
+        E p1 = square<Mul>(m.e01);
+        E p2 = square<Mul>(m.e00 + m.e01);
+        return { p0 + p1, p2 - p0 };
+    }
+
+    template<UInt T, typename Mul, typename Scheme, scan_t Scan>
+    matrix_engine<T, Mul, Scheme, Scan>::matrix_t matrix_engine<T, Mul, Scheme, Scan>::mul(const matrix_t &lhs, const matrix_t &rhs)
+    {
+        return Scheme::template mul<Mul>(lhs, rhs);
+    }
+
+    template<UInt T, typename Mul, typename Scheme, scan_t Scan>
+    matrix_engine<T, Mul, Scheme, Scan>::matrix_t matrix_engine<T, Mul, Scheme, Scan>::sqr(const matrix_t &m)
+    {
+        return Scheme::template sqr<Mul>(m);
+    }
+
+    template<UInt T, typename Mul, typename Scheme, scan_t Scan>
+    number matrix_engine<T, Mul, Scheme, Scan>::fibonacci(number n)
+    {
+        if (std::optional<number> small = small_fibonacci(n))
+        {
+            return *std::move(small);
+        }
+        return value(power<Scan, matrix_engine>(step(), n));
+    }
+
+} // namespace fib
+
+#endif//__FIB_MATRIX_H
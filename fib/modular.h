@@ -0,0 +1,358 @@
+/* Fibonacci numbers modulo m (without ever computing F(n) itself)
+ *
+ * Fast doubling (see fib/doubling.h) in the ring Z/mZ, which is either
+ *   - word-sized: Montgomery arithmetic for odd m, masking for powers of two,
+ *     and the CRT to glue both together for even m, or
+ *   - big: Barrett reduction on top of a num_t multiplication backend.
+ *
+ * When the factorisation of m is known, the index is first reduced modulo a
+ * multiple of the Pisano period of m (the period of F mod m).
+ */
+
+#ifndef __FIB_MODULAR_H
+#define __FIB_MODULAR_H
+
+#include "num/number.h"
+#include "num/barrett.h"
+#include "num/decimal.h"
+#include "num/mulnum_karatsuba.h"
+
+#include <bit>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace fib
+{
+
+    using big::UInt;
+    using big::number;
+    using big::product;
+    using big::square;
+    using big::barrett;
+
+    using u128 = unsigned __int128;
+
+    /* p^k, for a prime p */
+    struct prime_power
+    {
+        std::uint64_t p;
+        unsigned k = 1;
+    };
+
+    /* Montgomery arithmetic modulo an odd word (elements are x 2^64 mod m) */
+    class montgomery64
+    {
+        std::uint64_t m;
+        std::uint64_t inv; // m^-1 mod 2^64
+        std::uint64_t r2;  // 2^128 mod m
+
+        inline std::uint64_t redc(u128) const;
+
+    public:
+        using value_t = std::uint64_t;
+
+        explicit inline montgomery64(std::uint64_t);
+
+        value_t zero() const { return 0; }
+        value_t one() const { return to(1); }
+        value_t to(std::uint64_t x) const { return redc(static_cast<u128>(x % m) * r2); }
+        std::uint64_t from(value_t x) const { return redc(x); }
+
+        inline value_t add(value_t, value_t) const;
+        inline value_t sub(value_t, value_t) const;
+        value_t mul(value_t a, value_t b) const { return redc(static_cast<u128>(a) * b); }
+        value_t sqr(value_t a) const { return mul(a, a); }
+    };
+
+    /* arithmetic modulo 2^bits (bits <= 64) */
+    class pow2_64
+    {
+        std::uint64_t mask;
+
+    public:
+        using value_t = std::uint64_t;
+
+        explicit pow2_64(unsigned bits) : mask(bits < 64 ? (std::uint64_t(1) << bits) - 1 : -std::uint64_t(1)) {}
+
+        value_t zero() const { return 0; }
+        value_t one() const { return 1 & mask; }
+
+        value_t add(value_t a, value_t b) const { return (a + b) & mask; }
+        value_t sub(value_t a, value_t b) const { return (a - b) & mask; }
+        value_t mul(value_t a, value_t b) const { return (a * b) & mask; }
+        value_t sqr(value_t a) const { return mul(a, a); }
+    };
+
+    /* F(n) in any of the rings above, or big::barrett (in the ring's representation) */
+    template<typename Ring>
+    inline Ring::value_t fibonacci_in(const Ring &, const number &n);
+
+    /* a multiple of the Pisano period of the product of the given prime powers
+     * (the lcm of the bounds p^(k-1) * pi(p), where pi(p) divides
+     * p - 1 or 2(p + 1)), or 0 if it does not fit in 128 bits
+     */
+    inline u128 pisano_multiple(std::span<const prime_power>);
+
+    /* F(n) mod m, assuming m > 0, in O(log n) word operations */
+    inline std::uint64_t fibonacci_mod(const number &n, std::uint64_t m);
+    /* same, reducing n modulo the Pisano period first
+     * (factors are ignored unless they multiply to m)
+     */
+    inline std::uint64_t fibonacci_mod(const number &n, std::uint64_t m, std::span<const prime_power> factors);
+
+    /* F(n) mod m for a big m > 0 */
+    template<typename Mul, UInt T>
+    inline big::num_t<T> fibonacci_mod(const number &n, const big::num_t<T> &m);
+    /* same, reducing n modulo a multiple of the Pisano period first
+     * (the product of the prime-power bounds; assumes the factors multiply
+     * to m)
+     */
+    template<typename Mul, UInt T>
+    inline big::num_t<T> fibonacci_mod(const number &n, const big::num_t<T> &m, std::span<const prime_power> factors);
+
+    /* x^e, by squaring from the top bit of e */
+    template<typename Mul, UInt T>
+    inline big::num_t<T> power(const big::num_t<T> &x, size_t e);
+
+    /* the last k decimal digits of F(n) (zero-padded), i.e. F(n) mod 10^k */
+    inline std::string trailing_digits(const number &n, size_t k);
+
+    //////////////// IMPLEMENTATIONS ////////////////
+
+    /* x^-1 mod 2^64, for odd x (Newton's iteration doubles the correct bits) */
+    inline std::uint64_t inverse64(std::uint64_t x)
+    {
+        std::uint64_t inv = x; // correct to 3 bits
+        for (int i = 0; i < 5; ++i)
+        {
+            inv *= 2 - x * inv;
+        }
+        return inv;
+    }
+
+    montgomery64::montgomery64(std::uint64_t m)
+        : m(m)
+        , inv(inverse64(m))
+    {
+        std::uint64_t r1 = -m % m; // 2^64 mod m
+        r2 = static_cast<std::uint64_t>(static_cast<u128>(r1) * r1 % m);
+    }
+
+    /* t 2^-64 mod m, assuming t < m 2^64 */
+    std::uint64_t montgomery64::redc(u128 t) const
+    {
+        // t - u m has no low word, so no carries to track
+        std::uint64_t lo = static_cast<std::uint64_t>(t);
+        std::uint64_t hi = static_cast<std::uint64_t>(t >> 64);
+        std::uint64_t u = lo * inv;
+        std::uint64_t um = static_cast<std::uint64_t>(static_cast<u128>(u) * m >> 64);
+        return hi >= um ? hi - um : hi - um + m;
+    }
+
+    montgomery64::value_t montgomery64::add(value_t a, value_t b) const
+    {
+        // may wrap around when m > 2^63
+        value_t s = a + b;
+        return s < a || s >= m ? s - m : s;
+    }
+    montgomery64::value_t montgomery64::sub(value_t a, value_t b) const
+    {
+        return a >= b ? a - b : a - b + m;
+    }
+
+    template<typename Ring>
+    Ring::value_t fibonacci_in(const Ring &ring, const number &n)
+    {
+        // (a, b) = (F(k), F(k+1)), where k is the prefix of n scanned so far
+        auto a = ring.zero();
+        auto b = ring.one();
+        for (size_t bit = n.bit_width(); bit-- > 0; )
+        {
+            auto c = ring.mul(a, ring.sub(ring.add(b, b), a));
+            auto d = ring.add(ring.sqr(a), ring.sqr(b));
+            if (n.bit(bit))
+            {
+                b = ring.add(c, d);
+                a = std::move(d);
+            }
+            else
+            {
+                a = std::move(c);
+                b = std::move(d);
+            }
+        }
+        return a;
+    }
+
+    inline u128 gcd128(u128 a, u128 b)
+    {
+        while (b)
+        {
+            a = std::exchange(b, a % b);
+        }
+        return a;
+    }
+
+    /* a multiple of pi(p) (and pi(p^k) divides p^(k-1) pi(p)) */
+    inline u128 pisano_bound(const prime_power &f)
+    {
+        return f.p == 2 ? 3
+             : f.p == 5 ? 20
+             : f.p % 5 == 1 || f.p % 5 == 4 ? f.p - 1
+             : 2 * static_cast<u128>(f.p) + 2;
+    }
+
+    u128 pisano_multiple(std::span<const prime_power> factors)
+    {
+        constexpr u128 max = -static_cast<u128>(1);
+        u128 out = 1;
+        for (const prime_power &f : factors)
+        {
+            u128 bound = pisano_bound(f);
+            for (unsigned i = 1; i < f.k; ++i)
+            {
+                if (bound > max / f.p)
+                {
+                    return 0;
+                }
+                bound *= f.p;
+            }
+            u128 g = gcd128(out, bound);
+            if (out / g > max / bound)
+            {
+                return 0;
+            }
+            out = out / g * bound;
+        }
+        return out;
+    }
+
+    std::uint64_t fibonacci_mod(const number &n, std::uint64_t m)
+    {
+        unsigned twos = std::countr_zero(m);
+        std::uint64_t odd = m >> twos;
+        if (twos == 0)
+        {
+            montgomery64 ring(m);
+            return ring.from(fibonacci_in(ring, n));
+        }
+        pow2_64 ring2(twos);
+        std::uint64_t r2 = fibonacci_in(ring2, n);
+        if (odd == 1)
+        {
+            return r2;
+        }
+
+        // x = r1 + odd * ((r2 - r1) / odd mod 2^twos) is r1 mod odd and r2 mod 2^twos
+        montgomery64 ring1(odd);
+        std::uint64_t r1 = ring1.from(fibonacci_in(ring1, n));
+        return r1 + odd * ring2.mul(r2 - r1, inverse64(odd));
+    }
+
+    std::uint64_t fibonacci_mod(const number &n, std::uint64_t m, std::span<const prime_power> factors)
+    {
+        u128 prod = 1;
+        for (const prime_power &f : factors)
+        {
+            for (unsigned i = 0; i < f.k && prod <= m; ++i)
+            {
+                prod *= f.p;
+            }
+        }
+        u128 period = prod == m ? pisano_multiple(factors) : 0;
+        if (period == 0 || period >> 127)
+        {
+            return fibonacci_mod(n, m);
+        }
+
+        u128 index = 0;
+        for (size_t bit = n.bit_width(); bit-- > 0; )
+        {
+            index = index << 1 | n.bit(bit);
+            if (index >= period)
+            {
+                index -= period;
+            }
+        }
+        return fibonacci_mod(number(std::vector<std::uint64_t> {
+            static_cast<std::uint64_t>(index),
+            static_cast<std::uint64_t>(index >> 64) }), m);
+    }
+
+    template<typename Mul, UInt T>
+    big::num_t<T> fibonacci_mod(const number &n, const big::num_t<T> &m)
+    {
+        barrett<Mul, T> ring(m);
+        return fibonacci_in(ring, n);
+    }
+
+    template<typename Mul, UInt T>
+    big::num_t<T> power(const big::num_t<T> &x, size_t e)
+    {
+        big::num_t<T> out(1);
+        for (size_t bit = std::bit_width(e); bit-- > 0; )
+        {
+            out = square<Mul>(out);
+            if (e >> bit & 1)
+            {
+                out = product<Mul>(out, x);
+            }
+        }
+        return out;
+    }
+
+    template<typename Mul, UInt T>
+    big::num_t<T> fibonacci_mod(const number &n, const big::num_t<T> &m, std::span<const prime_power> factors)
+    {
+        using num = big::num_t<T>;
+
+        // the product of the bounds p^(k-1) pi(p)
+        num period(1);
+        for (const prime_power &f : factors)
+        {
+            u128 bound = pisano_bound(f);
+            period = product<Mul>(period, static_cast<num>(number(std::vector<std::uint64_t> {
+                static_cast<std::uint64_t>(bound),
+                static_cast<std::uint64_t>(bound >> 64) })));
+            if (f.k > 1)
+            {
+                period = product<Mul>(period, power<Mul>(num(f.p), f.k - 1));
+            }
+        }
+
+        num index = static_cast<num>(n);
+        if (index >= period)
+        {
+            index = barrett<Mul, T>(period).mod(index);
+        }
+        return fibonacci_mod<Mul>(static_cast<number>(index), m);
+    }
+
+    std::string trailing_digits(const number &n, size_t k)
+    {
+        // pi(10^k) divides lcm(pi(2^k), pi(5^k))
+        prime_power factors[] = { { 2, static_cast<unsigned>(k) }, { 5, static_cast<unsigned>(k) } };
+        std::string digits;
+        if (k <= 19)
+        {
+            std::uint64_t m = 1;
+            for (size_t i = 0; i < k; ++i)
+            {
+                m *= 10;
+            }
+            digits = std::to_string(fibonacci_mod(n, m, factors));
+        }
+        else
+        {
+            using num = big::num_t<std::uint32_t>;
+            using mul = big::karatsuba::cutoff_backend<>;
+            digits = big::decimal_string(fibonacci_mod<mul>(n, power<mul>(num(10), k), factors));
+        }
+        return std::string(k - digits.size(), '0') + digits;
+    }
+
+} // namespace fib
+
+#endif//__FIB_MODULAR_H
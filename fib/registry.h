@@ -0,0 +1,125 @@
+/* Every implementation in one binary
+ *
+ * Each of the impl/ sources wraps its definitions in FIB_IMPL_BEGIN(name)
+ * and FIB_IMPL_END(name). Normally these expand to nothing, and the file
+ * defines the global fibonacci as before (one implementation per binary).
+ * Compiled with FIB_REGISTRY, the definitions go into a namespace of their
+ * own instead, and are registered under the name, so any number of
+ * implementations can be linked together; the global fibonacci (see
+ * fib_base.h) then calls whichever is selected.
+ */
+
+#ifndef __FIB_REGISTRY_H
+#define __FIB_REGISTRY_H
+
+#include "num/number.h"
+
+#include <algorithm>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#ifdef FIB_REGISTRY
+#define FIB_IMPL_BEGIN(NAME) namespace fib_impl_##NAME {
+#define FIB_IMPL_END(NAME) } \
+    static const bool fib_registered_##NAME = ::fib::register_algorithm({ #NAME, fib_impl_##NAME::fibonacci, fib_impl_##NAME::fibonacci });
+#else
+#define FIB_IMPL_BEGIN(NAME)
+#define FIB_IMPL_END(NAME)
+#endif//FIB_REGISTRY
+
+namespace fib
+{
+
+    using big::number;
+
+    struct algorithm
+    {
+        const char *name;
+        number (*one)(number);
+        std::vector<number> (*many)(std::span<const number>);
+    };
+
+    /* every registered algorithm, in registration (i.e., link) order */
+    inline std::vector<algorithm> &algorithms();
+
+    inline bool register_algorithm(algorithm);
+
+    /* the one the global fibonacci calls (the first registered by default) */
+    inline const algorithm &selected_algorithm();
+    inline void select_algorithm(const algorithm &);
+
+    /* the algorithms named in a comma-separated list (empty if any is unknown) */
+    inline std::vector<const algorithm *> find_algorithms(std::string_view names);
+
+    /* "name, name, ..." */
+    inline std::string algorithm_names();
+
+    //////////////// IMPLEMENTATIONS ////////////////
+
+    std::vector<algorithm> &algorithms()
+    {
+        static std::vector<algorithm> all;
+        return all;
+    }
+
+    bool register_algorithm(algorithm algo)
+    {
+        algorithms().push_back(algo);
+        return true;
+    }
+
+    inline const algorithm *&selected()
+    {
+        static const algorithm *algo = nullptr;
+        return algo;
+    }
+
+    const algorithm &selected_algorithm()
+    {
+        return selected() ? *selected() : algorithms().front();
+    }
+
+    void select_algorithm(const algorithm &algo)
+    {
+        selected() = &algo;
+    }
+
+    std::vector<const algorithm *> find_algorithms(std::string_view names)
+    {
+        std::vector<const algorithm *> out;
+        for (size_t start = 0, end; start < names.size(); start = end + 1)
+        {
+            end = std::min(names.find(',', start), names.size());
+            std::string_view name = names.substr(start, end - start);
+            const algorithm *found = nullptr;
+            for (const algorithm &algo : algorithms())
+            {
+                if (algo.name == name)
+                {
+                    found = &algo;
+                }
+            }
+            if (!found)
+            {
+                return {};
+            }
+            out.push_back(found);
+        }
+        return out;
+    }
+
+    std::string algorithm_names()
+    {
+        std::string out;
+        for (const algorithm &algo : algorithms())
+        {
+            out += (out.empty() ? "" : ", ") + std::string(algo.name);
+        }
+        return out;
+    }
+
+} // namespace fib
+
+#endif//__FIB_REGISTRY_H
@@ -0,0 +1,179 @@
+/* Exponent scanning strategies for the power engines
+ *
+ * `power` only relies on the engine's `mul` and `sqr`, and on the
+ * element's `next` (which multiplies by the step using additions only).
+ */
+
+#ifndef __FIB_SCAN_H
+#define __FIB_SCAN_H
+
+#include "num/number.h"
+#include "fib/checkpoint.h"
+
+#include <optional>
+#include <vector>
+
+namespace fib
+{
+
+    using big::number;
+
+    enum class scan_t
+    {
+        /* square-and-multiply from the least significant bit
+         * (every set bit multiplies by a large power of the step)
+         */
+        lsb_first = 0,
+        /* square-and-multiply from the most significant bit
+         * (every set bit multiplies by the step itself, which only needs additions)
+         */
+        msb_first = 1,
+        /* k-ary sliding window from the most significant bit
+         * (every window multiplies by a precomputed odd power of the step)
+         */
+        sliding_window = 2,
+    };
+
+    /* computes step^n, assuming n > 0
+     *
+     * (periodically checkpointed when scanning bit by bit; see fib/checkpoint.h)
+     */
+    template<scan_t Scan, typename Engine, typename E>
+    inline E power(const E &step, const number &n);
+
+    /* window width minimising the number of multiplications for a given
+     * number of exponent bits
+     */
+    inline size_t window_width(size_t bits);
+
+    //////////////// IMPLEMENTATIONS ////////////////
+
+    size_t window_width(size_t bits)
+    {
+        // k-ary windows need 2^(k-1) multiplications for the table, and
+        // save about bits/(k+1) multiplications over k = 1
+        size_t k = 1;
+        while (bits > (k + 1) * (k + 2) << (k - 1))
+        {
+            ++k;
+        }
+        return k;
+    }
+
+    template<scan_t Scan, typename Engine, typename E>
+    E power(const E &step, const number &n)
+    {
+        using tag = std::tuple<Engine, std::integral_constant<scan_t, Scan>>;
+
+        if constexpr(Scan == scan_t::lsb_first)
+        {
+            E square = step;
+            std::optional<E> out;
+            size_t bits = n.bit_width();
+            size_t left = bits;
+            restore(typeid(tag), n, left, 1, square, out);
+            while (true)
+            {
+                if (n.bit(bits - left))
+                {
+                    out = out ? Engine::mul(*out, square) : square;
+                }
+                if (--left == 0)
+                {
+                    break;
+                }
+                square = Engine::sqr(square);
+                if (big::next_bit(bits - left, bits))
+                {
+                    break;
+                }
+                periodic_save(typeid(tag), n, left, square, out);
+            }
+            return out ? *out : square;
+        }
+        else if constexpr(Scan == scan_t::msb_first)
+        {
+            // out = step^k, where k is the prefix of n scanned so far
+            E out = step;
+            size_t bits = n.bit_width() - 1;
+            size_t bit = bits;
+            restore(typeid(tag), n, bit, 0, out);
+            while (bit-- > 0)
+            {
+                out = Engine::sqr(out);
+                if (n.bit(bit))
+                {
+                    out = out.next();
+                }
+                if (big::next_bit(bits - bit, bits))
+                {
+                    break;
+                }
+                periodic_save(typeid(tag), n, bit, out);
+            }
+            return out;
+        }
+        else
+        {
+            size_t bits = n.bit_width();
+            size_t k = window_width(bits);
+
+            // odd powers step, step^3, ..., step^(2^k - 1)
+            std::vector<E> table { step };
+            if (k > 1)
+            {
+                E step2 = Engine::sqr(step);
+                for (size_t i = 1; i < (static_cast<size_t>(1) << (k - 1)); ++i)
+                {
+                    table.push_back(Engine::mul(table.back(), step2));
+                }
+            }
+
+            std::optional<E> out;
+            size_t top = bits; // bits [top, bits) have been scanned
+            while (top > 0)
+            {
+                if (big::next_bit(bits - top, bits))
+                {
+                    return out ? *out : step;
+                }
+                if (!n.bit(top - 1))
+                {
+                    out = Engine::sqr(*out);
+                    --top;
+                    continue;
+                }
+
+                // window [low, top) ending in a set bit
+                size_t low = top > k ? top - k : 0;
+                while (!n.bit(low))
+                {
+                    ++low;
+                }
+                size_t window = 0;
+                for (size_t bit = top; bit-- > low; )
+                {
+                    window = (window << 1) | n.bit(bit);
+                }
+
+                if (!out)
+                {
+                    out = table[window >> 1];
+                }
+                else
+                {
+                    for (size_t bit = low; bit < top; ++bit)
+                    {
+                        out = Engine::sqr(*out);
+                    }
+                    out = window == 1 ? out->next() : Engine::mul(*out, table[window >> 1]);
+                }
+                top = low;
+            }
+            return *out;
+        }
+    }
+
+} // namespace fib
+
+#endif//__FIB_SCAN_H
@@ -0,0 +1,125 @@
+/* Small indices, without touching the heap
+ *
+ * F(0), ..., F(186) are the 128-bit Fibonacci numbers, and come from a
+ * table built at compile time. Beyond that, and as long as F(n) fits in a
+ * few fixed_t limbs, fast doubling (see fib/doubling.h) runs modulo
+ * 2^(64 N): intermediate values may wrap around, but F(n) itself does not.
+ * The width doubles along the way, as the prefix of n scanned so far grows.
+ */
+
+#ifndef __FIB_SMALL_H
+#define __FIB_SMALL_H
+
+#include "num/number.h"
+#include "num/fixed.h"
+
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <utility>
+#include <vector>
+
+namespace fib
+{
+
+    using big::number;
+    using big::fixed_t;
+
+    using u128 = unsigned __int128;
+
+    /* F(0), ..., F(186) */
+    constexpr size_t small_table_size = 187;
+    constexpr std::array<u128, small_table_size> small_table = []
+    {
+        std::array<u128, small_table_size> table {};
+        table[1] = 1;
+        for (size_t i = 2; i < small_table_size; ++i)
+        {
+            table[i] = table[i - 1] + table[i - 2];
+        }
+        return table;
+    }();
+
+    /* the largest index with F(n) < 2^(64 N) is at least 92 N
+     * (F(n) < phi^n, and 92 log2(phi) < 64)
+     */
+    template<size_t N>
+    constexpr std::uint64_t small_limit = 92 * N;
+
+    /* the widest fixed_t used (F(n) up to about 4,000 digits) */
+    constexpr size_t small_limbs = 64;
+
+    /* (F(n), F(n+1)) in N limbs, for n < small_limit<N> */
+    template<size_t N>
+    constexpr inline std::pair<fixed_t<N>, fixed_t<N>> small_fibonacci(std::uint64_t n);
+
+    /* F(n) if n < small_limit<small_limbs>, or nothing */
+    inline std::optional<number> small_fibonacci(const number &n);
+
+    //////////////// IMPLEMENTATIONS ////////////////
+
+    template<size_t N>
+    constexpr std::pair<fixed_t<N>, fixed_t<N>> small_fibonacci(std::uint64_t n)
+    {
+        // (a, b) = (F(k), F(k+1)), where k is the prefix of n scanned so far
+        fixed_t<N> a(0);
+        fixed_t<N> b(1);
+        std::uint64_t bit = std::bit_width(n);
+        if constexpr (N > 1)
+        {
+            // the longest prefix that still fits in half the limbs is
+            // computed there, so only the last few bits run at full width
+            while (bit > 0 && (n >> (bit - 1)) < small_limit<N / 2>)
+            {
+                --bit;
+            }
+            if (bit < std::bit_width(n))
+            {
+                auto [f, g] = small_fibonacci<N / 2>(n >> bit);
+                a = fixed_t<N>(f);
+                b = fixed_t<N>(g);
+            }
+        }
+        while (bit-- > 0)
+        {
+            fixed_t<N> c = a * (b + b - a);
+            fixed_t<N> d = a * a + b * b;
+            if (n >> bit & 1)
+            {
+                b = c + d;
+                a = d;
+            }
+            else
+            {
+                a = c;
+                b = d;
+            }
+        }
+        return { a, b };
+    }
+
+    std::optional<number> small_fibonacci(const number &n)
+    {
+        if (n.value.size() > 1)
+        {
+            return std::nullopt;
+        }
+        std::uint64_t k = n.value.empty() ? 0 : n.value[0];
+
+        if (k < small_table_size)
+        {
+            u128 f = small_table[k];
+            return number(std::vector<std::uint64_t> {
+                static_cast<std::uint64_t>(f),
+                static_cast<std::uint64_t>(f >> 64) });
+        }
+        if (k < small_limit<small_limbs>)
+        {
+            return static_cast<number>(small_fibonacci<small_limbs>(k).first);
+        }
+        return std::nullopt;
+    }
+
+} // namespace fib
+
+#endif//__FIB_SMALL_H
@@ -1,9 +1,63 @@
 #ifndef __FIB_BASE_H
 #define __FIB_BASE_H
 
+#include <limits>
+#include <optional>
+#include <span>
+#include <utility>
+#include <vector>
+
 #include "num/number.h"
 using big::number;
 
+#include "fib/registry.h"
+
+#ifdef FIB_REGISTRY
+
+/* the selected implementation (see fib/registry.h) */
+inline number fibonacci(number n)
+{
+    return fib::selected_algorithm().one(std::move(n));
+}
+
+inline std::vector<number> fibonacci(std::span<const number> ns)
+{
+    return fib::selected_algorithm().many(ns);
+}
+
+#else
+
 number fibonacci(number);
 
+/* same as calling fibonacci on each index (but may share work between them) */
+std::vector<number> fibonacci(std::span<const number>);
+
+#endif//FIB_REGISTRY
+
+/* fibonacci(n) under the given control (see num/control.h), which gets its
+ * progress reports; nothing if it was cancelled
+ */
+inline std::optional<number> fibonacci(number n, big::control &c)
+{
+    big::control_scope scope(c);
+    number out = fibonacci(std::move(n));
+    if (c.cancelled())
+    {
+        return std::nullopt;
+    }
+    return out;
+}
+
+/* a lower bound on the bytes computing F_n takes: F_n itself (about
+ * 0.694 n bits), and the operands of the product that gives it
+ */
+inline size_t fibonacci_min_bytes(const number &n)
+{
+    if (n.bit_width() > 48)
+    {
+        return std::numeric_limits<size_t>::max();
+    }
+    return static_cast<size_t>(0.6943 * static_cast<double>(n.value.empty() ? 0 : n.value[0]) / 8) * 2;
+}
+
 #endif//__FIB_BASE_H
@@ -1,29 +1,417 @@
+#include <algorithm>
 #include <chrono>
+#include <cctype>
+#include <climits>
+#include <cstdint>
+#include <cstdio>
+#include <iomanip>
 #include <iostream>
+#include <limits>
+#include <optional>
 #include <string>
+#include <string_view>
+#include <vector>
+
+#include <malloc.h>
 
 #include "fib_base.h"
+#include "options.h"
+#include "num/decimal.h"
+#include "fib/checkpoint.h"
+#include "fib/leading.h"
+#include "fib/modular.h"
 
 using sec_t = std::chrono::duration<double>;
 
+/* whether to show the progress of computations (and an estimate of the
+ * time left) on stderr, every second
+ */
+bool show_progress = false;
 
-int main()
+/* fibonacci(index), showing its progress */
+number fibonacci_with_progress(const number &index)
 {
-    std::string index_str;
-    std::cin >> index_str;
-    number index(index_str);
+    auto start = std::chrono::steady_clock::now();
+    auto shown = start;
+    bool any = false;
+    big::control control;
+    control.progress = [&](double done)
+    {
+        auto now = std::chrono::steady_clock::now();
+        if (now - shown < sec_t(1) || done <= 0)
+        {
+            return;
+        }
+        shown = now;
+        any = true;
+        sec_t left = sec_t(now - start) * ((1 - done) / done);
+        std::cerr << "\n    " << std::fixed << std::setprecision(1) << 100 * done << "% done, about "
+            << left.count() << "s left" << std::defaultfloat << std::flush;
+    };
+    number fib = *fibonacci(index, control); // (never cancelled)
+    if (any)
+    {
+        std::cerr << std::endl;
+    }
+    return fib;
+}
 
+/* F_index, printing how long it took (and how much memory) */
+number compute(const number &index)
+{
 #ifndef CHECK
     std::cout << "Computing F_" << index.str(true) << " in " << std::flush;
+    big::memory::reset_peak();
     auto start = std::chrono::steady_clock::now();
 #endif
 
-    number fib = fibonacci(index);
+    number fib;
+    {
+        PERF_SCOPE("exponent loop");
+        fib = show_progress ? fibonacci_with_progress(index) : fibonacci(index);
+    }
 
 #ifndef CHECK
     sec_t delta = std::chrono::steady_clock::now() - start;
-    std::cout << delta << std::endl;
+    std::cout << delta;
+    if (fib::checkpoint.resumed)
+    {
+        std::cout << " (resumed with " << *fib::checkpoint.resumed << " bits left)";
+    }
+    std::cout << std::endl;
+    std::cout << "Peak memory: ";
+    if (big::memory::counting)
+    {
+        // (only counted with --memory or --max-memory, see num/memory.h)
+        std::cout << big::memory::format_size(big::memory::peak_allocated()) << " allocated, ";
+    }
+    std::cout << big::memory::format_size(big::memory::peak_resident()) << " resident" << std::endl;
 #endif
+    return fib;
+}
+
+/* output formats of --batch */
+enum class format_t
+{
+    sci,    // as in the default output (full below ten digits)
+    dec,    // full decimal expansion
+    hex,    // full hexadecimal expansion
+    binary  // 8-byte little-endian length in bytes, then the bytes, least significant first
+};
+
+/* the length written in binary for a query without a result */
+constexpr std::uint64_t binary_error = ~std::uint64_t(0);
+
+void write_length(std::ostream &out, std::uint64_t bytes)
+{
+    unsigned char length[8];
+    for (size_t i = 0; i < 8; ++i)
+    {
+        length[i] = static_cast<unsigned char>(bytes >> (8 * i));
+    }
+    out.write(reinterpret_cast<const char *>(length), sizeof length);
+}
+
+bool write_result(std::ostream &out, const number &x, format_t format)
+{
+    switch (format)
+    {
+    case format_t::sci:
+        out << x.str(false) << '\n';
+        break;
+    case format_t::dec:
+        big::write_decimal(out, x);
+        out << '\n';
+        break;
+    case format_t::hex:
+        if (x.value.empty())
+        {
+            out << '0';
+        }
+        for (auto rit = x.value.rbegin(); rit != x.value.rend(); ++rit)
+        {
+            out << std::hex << std::setfill('0') << std::setw(rit == x.value.rbegin() ? 0 : 16) << *rit;
+        }
+        out << std::dec << '\n';
+        break;
+    case format_t::binary:
+    {
+        std::uint64_t bytes = (x.bit_width() + 7) / 8;
+        write_length(out, bytes);
+        for (size_t i = 0; i < bytes; ++i)
+        {
+            char byte = static_cast<char>(x.value[i / 8] >> (8 * (i % 8)));
+            out.put(byte);
+        }
+        break;
+    }
+    }
+    return static_cast<bool>(out.flush());
+}
+
+/* in place of a result: an empty line, or binary_error in binary */
+bool write_error(std::ostream &out, format_t format)
+{
+    if (format == format_t::binary)
+    {
+        write_length(out, binary_error);
+    }
+    else
+    {
+        out << '\n';
+    }
+    return static_cast<bool>(out.flush());
+}
+
+/* computes F_n for every index on stdin (one per line) until the end of the
+ * input, writing each result to stdout as soon as it is known, and its
+ * latency to stderr (a line that is not an index, or whose result would not
+ * fit in memory, gets an error record instead; see write_error)
+ */
+int batch(format_t format)
+{
+    // keep freed memory in the process: by default, glibc maps large blocks
+    // separately and hands them (and the top of the heap) back to the kernel
+    // on free, so every query would fault its pages in again
+    // (this and the decimal conversion's thread pool are all that stay warm:
+    // the FFT has no tables to keep, it computes one root of unity per pass)
+    mallopt(M_MMAP_MAX, 0);
+    mallopt(M_TRIM_THRESHOLD, INT_MAX);
+
+    std::ios::sync_with_stdio(false);
+    std::vector<sec_t> latencies;
+    std::string line;
+    while (std::getline(std::cin, line))
+    {
+        // (only around the index: "12 34" is not an index)
+        constexpr const char *space = " \t\n\v\f\r";
+        size_t first = line.find_first_not_of(space);
+        if (first == std::string::npos)
+        {
+            continue;
+        }
+        line = line.substr(first, line.find_last_not_of(space) + 1 - first);
+
+        std::optional<number> fib;
+        auto start = std::chrono::steady_clock::now();
+        if (!std::all_of(line.begin(), line.end(), [](char c) { return c >= '0' && c <= '9'; }))
+        {
+            std::cerr << "Not an index: " << line << std::endl;
+        }
+        else if (number index(line); !big::memory::fits(fibonacci_min_bytes(index)))
+        {
+            std::cerr << "F_" << line << " does not fit in " << big::memory::format_size(big::memory::budget()) << std::endl;
+        }
+        else
+        {
+            fib = fibonacci(index);
+        }
+        sec_t compute = std::chrono::steady_clock::now() - start;
+        // (an error record keeps the output in step with the input)
+        if (!(fib ? write_result(std::cout, *fib, format) : write_error(std::cout, format)))
+        {
+            return 1;
+        }
+        if (fib)
+        {
+            sec_t total = std::chrono::steady_clock::now() - start;
+            latencies.push_back(total);
+            std::cerr << "F_" << line << ": " << total.count() << "s (" << compute.count() << "s computing)" << std::endl;
+        }
+    }
+
+    if (!latencies.empty())
+    {
+        std::sort(latencies.begin(), latencies.end());
+        std::cerr << latencies.size() << " queries, latency median " << latencies[latencies.size() / 2].count()
+            << "s, max " << latencies.back().count() << "s" << std::endl;
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    size_t leading = 0;  // only compute this many leading digits
+    size_t trailing = 0; // ... and/or this many trailing ones
+    bool full = false;   // print the full expansion without asking
+    bool batched = false; // many indices, one result per line (see batch)
+    format_t format = format_t::sci;
+#ifdef FIB_REGISTRY
+    std::vector<const fib::algorithm *> algos; // run (and compare) each of these
+#endif
+    auto usage = [&]
+    {
+#ifdef FIB_REGISTRY
+        std::cerr << "Usage: " << argv[0] << " --algo=NAME[,NAME...]|--all" << std::endl
+            << "Algorithms: " << fib::algorithm_names() << std::endl;
+#endif
+        std::cerr << "Usage: " << argv[0] << " [--full] [--progress] [--batch [--format=sci|dec|hex|binary]] [--leading=DIGITS] [--trailing=DIGITS] [--memory] [--max-memory=BYTES[K|M|G]] [--checkpoint=FILE [--checkpoint-interval=SECONDS] [--resume]]" << std::endl;
+        return 1;
+    };
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string_view arg(argv[i]);
+        if (arg.starts_with("--checkpoint="))
+        {
+            fib::checkpoint.path = arg.substr(arg.find('=') + 1);
+        }
+        else if (arg.starts_with("--checkpoint-interval="))
+        {
+            double seconds;
+            if (!parse_option(arg.substr(arg.find('=') + 1), seconds, std::numeric_limits<double>::min(), std::numeric_limits<double>::max()))
+            {
+                return usage();
+            }
+            fib::checkpoint.interval = sec_t(seconds);
+        }
+        else if (arg == "--resume")
+        {
+            fib::checkpoint.resume = true;
+        }
+        else if (arg.starts_with("--leading="))
+        {
+            if (!parse_option(arg.substr(arg.find('=') + 1), leading, size_t(1), SIZE_MAX))
+            {
+                return usage();
+            }
+        }
+        else if (arg == "--full")
+        {
+            full = true;
+        }
+        else if (arg == "--progress")
+        {
+            show_progress = true;
+        }
+        else if (arg == "--batch")
+        {
+            batched = true;
+        }
+        else if (arg == "--format=sci" || arg == "--format=dec" || arg == "--format=hex" || arg == "--format=binary")
+        {
+            std::string_view value = arg.substr(arg.find('=') + 1);
+            format = value == "sci" ? format_t::sci : value == "dec" ? format_t::dec : value == "hex" ? format_t::hex : format_t::binary;
+        }
+        else if (arg == "--memory")
+        {
+            big::memory::start_counting();
+        }
+        else if (arg.starts_with("--max-memory=") && big::memory::parse_size(arg.substr(arg.find('=') + 1)) > 0)
+        {
+            big::memory::budget() = big::memory::parse_size(arg.substr(arg.find('=') + 1));
+            big::memory::start_counting();
+        }
+        else if (arg.starts_with("--trailing="))
+        {
+            if (!parse_option(arg.substr(arg.find('=') + 1), trailing, size_t(1), SIZE_MAX))
+            {
+                return usage();
+            }
+        }
+#ifdef FIB_REGISTRY
+        else if (arg.starts_with("--algo=") && !fib::find_algorithms(arg.substr(arg.find('=') + 1)).empty())
+        {
+            algos = fib::find_algorithms(arg.substr(arg.find('=') + 1));
+        }
+        else if (arg == "--all")
+        {
+            algos.clear();
+            for (const fib::algorithm &algo : fib::algorithms())
+            {
+                algos.push_back(&algo);
+            }
+        }
+#endif
+        else
+        {
+            return usage();
+        }
+    }
+    if (fib::checkpoint.resume && fib::checkpoint.path.empty())
+    {
+        std::cerr << "--resume needs a --checkpoint file" << std::endl;
+        return 1;
+    }
+#ifdef FIB_REGISTRY
+    if (algos.empty())
+    {
+        std::cerr << "Choose an algorithm with --algo=NAME (or --all): " << fib::algorithm_names() << std::endl;
+        return 1;
+    }
+    if (algos.size() > 1 && (!fib::checkpoint.path.empty() || batched))
+    {
+        std::cerr << "--checkpoint and --batch need a single --algo" << std::endl;
+        return 1;
+    }
+    fib::select_algorithm(*algos.front());
+#endif
+    if (batched)
+    {
+        if (leading || trailing || !fib::checkpoint.path.empty())
+        {
+            std::cerr << "--batch computes whole numbers only, without checkpoints" << std::endl;
+            return 1;
+        }
+        return batch(format);
+    }
+
+    std::string index_str;
+    std::cin >> index_str;
+    number index;
+    {
+        PERF_SCOPE("parse index");
+        index = number(index_str);
+    }
+
+    if (leading || trailing)
+    {
+        std::cout << "Computing the digits of F_" << index.str(true) << " in " << std::flush;
+        auto start = std::chrono::steady_clock::now();
+        std::string lead = leading ? fib::leading_digits(index, leading).str() : "";
+        std::string trail = trailing ? fib::trailing_digits(index, trailing) : "";
+        sec_t delta = std::chrono::steady_clock::now() - start;
+        std::cout << delta << std::endl;
+        if (leading)
+        {
+            std::cout << "Leading digits: " << lead << std::endl;
+        }
+        if (trailing)
+        {
+            std::cout << "Trailing digits: ..." << trail << std::endl;
+        }
+        return 0;
+    }
+
+    if (!big::memory::fits(fibonacci_min_bytes(index)))
+    {
+        std::cerr << "F_" << index.str(true) << " does not fit in " << big::memory::format_size(big::memory::budget()) << std::endl;
+        return 1;
+    }
+
+#ifdef FIB_REGISTRY
+    // one after the other, in the same process, checking they all agree
+    number fib;
+    for (const fib::algorithm *algo : algos)
+    {
+        fib::select_algorithm(*algo);
+#ifndef CHECK
+        std::cout << algo->name << ": ";
+#endif
+        number out = compute(index);
+        if (algo != algos.front() && out != fib)
+        {
+            std::cerr << "ERROR: " << algo->name << " disagrees with " << algos.front()->name << std::endl;
+            return 1;
+        }
+        fib = std::move(out);
+    }
+#else
+    number fib = compute(index);
+#endif
+    if (!fib::checkpoint.path.empty())
+    {
+        std::remove(fib::checkpoint.path.c_str());
+    }
 
 
 #ifdef CHECK
@@ -32,7 +420,23 @@ int main()
         std::cout << std::hex << *rit;
     }
     std::cout << std::endl;
-#elif !defined(PERF)
+#elif defined(PERF)
+    if (full)
+    {
+        // the conversion alone (nothing is printed)
+        PERF_SCOPE("decimal output");
+        big::write_decimal_to(fib, [](const char *, size_t) { return true; });
+    }
+    big::perf::write_report(std::cerr);
+#else
+    if (full)
+    {
+        std::cout << "Result: ";
+        big::write_decimal(std::cout, fib);
+        std::cout << std::endl;
+        return 0;
+    }
+
     std::string decimal = fib.str(false);
     std::cout << "Result: " << decimal << std::endl;
 
@@ -49,7 +453,8 @@ int main()
             }
             if (c == 'y' || c == 'Y')
             {
-                std::cout << fib.str(true) << std::endl;
+                big::write_decimal(std::cout, fib);
+                std::cout << std::endl;
                 break;
             }
         }
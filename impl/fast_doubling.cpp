@@ -0,0 +1,20 @@
+#include "num/mulnum_karatsuba.h"
+#include "fib/doubling.h"
+#include "fib/batch.h"
+#include "fib_base.h"
+
+FIB_IMPL_BEGIN(fast_doubling)
+
+using engine = fib::doubling_engine<std::uint32_t, big::karatsuba::backend>;
+
+number fibonacci(number n)
+{
+    return engine::fibonacci(n);
+}
+
+std::vector<number> fibonacci(std::span<const number> ns)
+{
+    return fib::batch_doubling<engine>(ns);
+}
+
+FIB_IMPL_END(fast_doubling)
@@ -1,11 +1,14 @@
+#include "fib/batch.h"
 #include "fib_base.h"
 
+FIB_IMPL_BEGIN(linear)
+
 number fibonacci(number n)
 {
     number a(0);
     number b(1);
     number tmp;
-    while (n-- > 0)
+    while (n-- > 0 && !big::cancelled())
     {
         tmp = a + b;
         a = b;
@@ -13,3 +16,10 @@ number fibonacci(number n)
     }
     return a;
 }
+
+std::vector<number> fibonacci(std::span<const number> ns)
+{
+    return fib::batch_scalar(ns, fibonacci);
+}
+
+FIB_IMPL_END(linear)
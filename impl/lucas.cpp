@@ -0,0 +1,20 @@
+#include "num/mulnum_fft.h"
+#include "fib/lucas.h"
+#include "fib/batch.h"
+#include "fib_base.h"
+
+FIB_IMPL_BEGIN(lucas)
+
+using engine = fib::lucas_engine<std::uint8_t, big::fft::backend>;
+
+number fibonacci(number n)
+{
+    return engine::fibonacci(n);
+}
+
+std::vector<number> fibonacci(std::span<const number> ns)
+{
+    return fib::batch_doubling<engine>(ns);
+}
+
+FIB_IMPL_END(lucas)
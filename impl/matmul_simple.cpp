@@ -1,39 +1,26 @@
 #include "num/mulnum_simple.h"
+#include "fib/matrix.h"
+#include "fib/batch.h"
 #include "fib_base.h"
 
-using num = big::num_t<std::uint32_t>;
+FIB_IMPL_BEGIN(matmul_simple)
 
-struct M2x2
-{
-    num e00, e01, e10, e11;
-    M2x2(num e00, num e01, num e10, num e11)
-        : e00(e00)
-        , e01(e01)
-        , e10(e10)
-        , e11(e11)
-    {}
-    
-    M2x2 operator*(M2x2 const &o)
-    {
-        return M2x2(
-                e00*o.e00 + e01*o.e10,
-                e00*o.e01 + e01*o.e11,
-                e10*o.e00 + e11*o.e10,
-                e10*o.e01 + e11*o.e11);
-    }
-    M2x2 &operator*=(M2x2 const &o)
-    {
-        return *this = *this * o;
-    }
-};
+using engine = fib::matrix_engine<std::uint32_t, big::simple::backend>;
 
 number fibonacci(number n)
 {
-    M2x2 fib(0, 1, 1, 1);
-    M2x2 step(fib);
-    while (n-- > 0)
+    engine::matrix_t fib = engine::matrix_t::step();
+    engine::matrix_t step(fib);
+    while (n-- > 0 && !big::cancelled())
     {
-        fib *= step;
+        fib = engine::mul(fib, step);
     }
     return (number)fib.e00; //static_cast<number>(fib.e00);
 }
+
+std::vector<number> fibonacci(std::span<const number> ns)
+{
+    return fib::batch_scalar(ns, fibonacci);
+}
+
+FIB_IMPL_END(matmul_simple)
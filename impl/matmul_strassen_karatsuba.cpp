@@ -0,0 +1,20 @@
+#include "num/mulnum_karatsuba.h"
+#include "fib/matrix.h"
+#include "fib/batch.h"
+#include "fib_base.h"
+
+FIB_IMPL_BEGIN(matmul_strassen_karatsuba)
+
+using engine = fib::matrix_engine<std::uint32_t, big::karatsuba::backend, fib::strassen>;
+
+number fibonacci(number n)
+{
+    return engine::fibonacci(n);
+}
+
+std::vector<number> fibonacci(std::span<const number> ns)
+{
+    return fib::batch<engine>(ns);
+}
+
+FIB_IMPL_END(matmul_strassen_karatsuba)
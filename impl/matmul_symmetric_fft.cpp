@@ -0,0 +1,20 @@
+#include "num/mulnum_fft.h"
+#include "fib/matrix.h"
+#include "fib/batch.h"
+#include "fib_base.h"
+
+FIB_IMPL_BEGIN(matmul_symmetric_fft)
+
+using engine = fib::matrix_engine<std::uint8_t, big::fft::backend, fib::symmetric, fib::scan_t::msb_first>;
+
+number fibonacci(number n)
+{
+    return engine::fibonacci(n);
+}
+
+std::vector<number> fibonacci(std::span<const number> ns)
+{
+    return fib::batch<engine>(ns);
+}
+
+FIB_IMPL_END(matmul_symmetric_fft)
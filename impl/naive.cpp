@@ -1,10 +1,20 @@
+#include "fib/batch.h"
 #include "fib_base.h"
 
+FIB_IMPL_BEGIN(naive)
+
 number fibonacci(number n)
 {
-    if (n <= 1)
+    if (n <= 1 || big::cancelled())
     {
         return n;
     }
     return fibonacci(n-1) + fibonacci(n-2);
 }
+
+std::vector<number> fibonacci(std::span<const number> ns)
+{
+    return fib::batch_scalar(ns, fibonacci);
+}
+
+FIB_IMPL_END(naive)
@@ -0,0 +1,236 @@
+/* Microbenchmarks for the kernels in num/
+ *
+ * Times each kernel over a geometric grid of operand sizes (in limbs of the
+ * kernel's own digit type), repeating calls until they add up to a minimum
+ * time, and stops growing a kernel once a single call exceeds the budget.
+ * Prints one row per (kernel, size), as CSV or JSON, with the throughput in
+ * limbs per second.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "options.h"
+#include "num/number.h"
+#include "num/mulnum_simple.h"
+#include "num/mulnum_karatsuba.h"
+#include "num/mulnum_dft.h"
+#include "num/mulnum_fft.h"
+#include "num/decimal.h"
+
+using sec_t = std::chrono::duration<double>;
+using big::num_t;
+
+struct
+{
+    size_t min_limbs = 16;
+    size_t max_limbs = size_t(1) << 22;
+    sec_t min_time = sec_t(0.2); // per grid point
+    sec_t budget = sec_t(2);     // for a single call
+    bool json = false;
+    std::vector<std::string> only; // kernels to run (all if empty)
+} settings;
+
+constexpr size_t no_limit = std::numeric_limits<size_t>::max();
+
+std::mt19937_64 rng(42);
+size_t sink = 0; // keeps results alive
+
+template<big::UInt T>
+num_t<T> random_num(size_t limbs)
+{
+    // (with the top bit set, so the size is exactly limbs)
+    std::vector<T> v;
+    v.reserve(limbs);
+    for (size_t i = 0; i < limbs; ++i)
+    {
+        T top = i + 1 == limbs ? T(1) << (big::bitlen<T> - 1) : 0;
+        v.push_back(static_cast<T>(rng()) | top);
+    }
+    return v;
+}
+
+/* a kernel, set up for a given size, returns the call to time */
+struct kernel
+{
+    std::string name;
+    size_t limb_bits;
+    size_t max_limbs;
+    std::function<std::function<void()>(size_t)> setup;
+};
+
+template<big::UInt T, typename F>
+kernel binary(std::string name, size_t max_limbs, F f)
+{
+    return { std::move(name), big::bitlen<T>, max_limbs, [f](size_t limbs) -> std::function<void()>
+            {
+                num_t<T> a = random_num<T>(limbs);
+                num_t<T> b = random_num<T>(limbs);
+                b.value.back() >>= 1; // b < a, for subtraction
+                return [f, a, b] { sink += f(a, b).value.size(); };
+            } };
+}
+
+template<big::UInt T, typename F>
+kernel unary(std::string name, size_t max_limbs, F f)
+{
+    return { std::move(name), big::bitlen<T>, max_limbs, [f](size_t limbs) -> std::function<void()>
+            {
+                num_t<T> a = random_num<T>(limbs);
+                return [f, a] { sink += f(a); };
+            } };
+}
+
+std::vector<kernel> kernels()
+{
+    using u8 = std::uint8_t;
+    using u32 = std::uint32_t;
+    using u64 = std::uint64_t;
+    return {
+        binary<u32>("add", no_limit, [](const num_t<u32> &a, const num_t<u32> &b) { return a + b; }),
+        binary<u32>("sub", no_limit, [](const num_t<u32> &a, const num_t<u32> &b) { return a - b; }),
+        unary<u32>("shl", no_limit, [](const num_t<u32> &a) { return (a << 13).value.size(); }),
+        unary<u32>("shr", no_limit, [](const num_t<u32> &a) { return (a >> 13).value.size(); }),
+        binary<u32>("mul_simple", no_limit, [](const num_t<u32> &a, const num_t<u32> &b) { return big::product<big::simple::backend>(a, b); }),
+        binary<u32>("mul_karatsuba", no_limit, [](const num_t<u32> &a, const num_t<u32> &b) { return big::product<big::karatsuba::backend>(a, b); }),
+        binary<u32>("mul_karatsuba_cutoff", no_limit, [](const num_t<u32> &a, const num_t<u32> &b) { return big::product<big::karatsuba::cutoff_backend<>>(a, b); }),
+        // (loses precision past a few million digits)
+        binary<u8>("mul_fft", size_t(1) << 22, [](const num_t<u8> &a, const num_t<u8> &b) { return big::product<big::fft::backend>(a, b); }),
+        binary<u8>("mul_dft", size_t(1) << 22, [](const num_t<u8> &a, const num_t<u8> &b) { return big::product<big::dft::backend>(a, b); }),
+        unary<u64>("str", no_limit, [](const num_t<u64> &a) { return a.str(true).size(); }),
+        unary<u64>("decimal", no_limit, [](const num_t<u64> &a) { return big::decimal_blocks(a).size(); }),
+    };
+}
+
+/* seconds per call, over reps calls (at least one, and at least min_time) */
+sec_t time_calls(const std::function<void()> &call, size_t &reps)
+{
+    reps = 0;
+    sec_t total(0);
+    for (size_t batch = 1; total < settings.min_time; batch <<= 1)
+    {
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < batch; ++i)
+        {
+            call();
+        }
+        total += std::chrono::steady_clock::now() - start;
+        reps += batch;
+        if (total > settings.budget)
+        {
+            break;
+        }
+    }
+    return total / static_cast<double>(reps);
+}
+
+int main(int argc, char *argv[])
+{
+    auto usage = [&]
+    {
+        std::cerr << "Usage: " << argv[0] << " [--format=csv|json] [--min-limbs=N] [--max-limbs=N] [--min-time=SECONDS] [--budget=SECONDS] [--kernels=NAME[,NAME...]]" << std::endl;
+        return 1;
+    };
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string_view arg(argv[i]);
+        std::string value(arg.substr(arg.find('=') + 1));
+        if (arg == "--format=csv" || arg == "--format=json")
+        {
+            settings.json = value == "json";
+        }
+        else if (arg.starts_with("--min-limbs=") || arg.starts_with("--max-limbs="))
+        {
+            size_t &limbs = arg.starts_with("--min-limbs=") ? settings.min_limbs : settings.max_limbs;
+            if (!parse_option(value, limbs, size_t(1), no_limit))
+            {
+                return usage();
+            }
+        }
+        else if (arg.starts_with("--min-time=") || arg.starts_with("--budget="))
+        {
+            sec_t &time = arg.starts_with("--min-time=") ? settings.min_time : settings.budget;
+            double seconds = 0;
+            if (!parse_option(value, seconds, std::numeric_limits<double>::min(), std::numeric_limits<double>::max()))
+            {
+                return usage();
+            }
+            time = sec_t(seconds);
+        }
+        else if (arg.starts_with("--kernels="))
+        {
+            for (size_t start = 0, end; start < value.size(); start = end + 1)
+            {
+                end = std::min(value.find(',', start), value.size());
+                settings.only.push_back(value.substr(start, end - start));
+            }
+        }
+        else
+        {
+            return usage();
+        }
+    }
+    if (settings.min_limbs > settings.max_limbs)
+    {
+        return usage();
+    }
+
+    if (settings.json)
+    {
+        std::cout << "[";
+    }
+    else
+    {
+        std::cout << "kernel,limb_bits,limbs,reps,seconds,limbs_per_second" << std::endl;
+    }
+    bool first = true;
+
+    for (const kernel &k : kernels())
+    {
+        if (!settings.only.empty() && std::find(settings.only.begin(), settings.only.end(), k.name) == settings.only.end())
+        {
+            continue;
+        }
+        for (size_t limbs = settings.min_limbs; limbs <= std::min(settings.max_limbs, k.max_limbs); limbs <<= 1)
+        {
+            std::function<void()> call = k.setup(limbs);
+            size_t reps;
+            sec_t per_call = time_calls(call, reps);
+            double throughput = static_cast<double>(limbs) / per_call.count();
+
+            if (settings.json)
+            {
+                std::cout << (first ? "\n  " : ",\n  ")
+                    << "{\"kernel\": \"" << k.name << "\", \"limb_bits\": " << k.limb_bits
+                    << ", \"limbs\": " << limbs << ", \"reps\": " << reps
+                    << ", \"seconds\": " << per_call.count() << ", \"limbs_per_second\": " << throughput << "}";
+            }
+            else
+            {
+                std::cout << k.name << ',' << k.limb_bits << ',' << limbs << ',' << reps << ','
+                    << per_call.count() << ',' << throughput << std::endl;
+            }
+            first = false;
+
+            if (per_call > settings.budget)
+            {
+                break;
+            }
+        }
+    }
+
+    if (settings.json)
+    {
+        std::cout << "\n]" << std::endl;
+    }
+    std::cerr << "(checksum " << sink << ")" << std::endl;
+    return 0;
+}
@@ -0,0 +1,189 @@
+/* Barrett reduction (division by a fixed big number, using only products)
+ */
+
+#ifndef __BARRETT_H
+#define __BARRETT_H
+
+#include "num/number.h"
+
+namespace big
+{
+
+    /* Barrett reduction modulo a big m, multiplying via a backend */
+    template<typename Mul, UInt T>
+    class barrett
+    {
+        using num = num_t<T>;
+
+        num m;
+        num r;    // floor(4^k / m)
+        size_t k; // bit width of m
+
+    public:
+        using value_t = num;
+
+        /* assumes m > 0 */
+        explicit inline barrett(num);
+
+        const num &modulus() const { return m; }
+
+        /* x mod m, assuming x < 4^k (e.g. a product of two residues) */
+        num reduce(num x) const { divide(x); return x; }
+        /* replaces x by x mod m and returns x / m, assuming x < 4^k */
+        inline num divide(num &x) const;
+        /* x mod m, for any x */
+        inline num mod(const num &) const;
+
+        value_t zero() const { return {}; }
+        value_t one() const { return reduce(1); }
+
+        inline value_t add(const value_t &, const value_t &) const;
+        inline value_t sub(const value_t &, const value_t &) const;
+        value_t mul(const value_t &a, const value_t &b) const { return reduce(product<Mul>(a, b)); }
+        value_t sqr(const value_t &a) const { return reduce(square<Mul>(a)); }
+    };
+
+    /* floor(4^k / m), where k is the bit width of m > 0 */
+    template<typename Mul, UInt T>
+    inline num_t<T> reciprocal(const num_t<T> &m);
+
+    //////////////// IMPLEMENTATIONS ////////////////
+
+    template<typename Mul, UInt T>
+    num_t<T> reciprocal(const num_t<T> &m)
+    {
+        using num = num_t<T>;
+
+        // Newton's iteration for 4^k / m stays below it
+        size_t k = m.bit_width();
+        const num four_k = num(1) << 2 * k;
+        num r, err;
+        if (k <= 64)
+        {
+            // from 2^k (relative error under 1/2)
+            r = num(1) << k;
+            while (true)
+            {
+                err = four_k - product<Mul>(m, r);
+                num step = product<Mul>(r, err) >> 2 * k;
+                if (step.value.empty())
+                {
+                    break;
+                }
+                r += step;
+            }
+        }
+        else
+        {
+            // from the reciprocal of the top half of m, shifted back and nudged
+            // down (relative error about 2^-half), so one step squares the
+            // error down to a few hundred units
+            size_t half = k / 2;
+            r = reciprocal<Mul>(m >> (k - half)) << (k - half);
+            r -= (r >> (half - 2)) + 1;
+            err = four_k - product<Mul>(m, r);
+            num step = product<Mul>(r, err) >> 2 * k;
+            r += step;
+            err -= product<Mul>(m, step);
+
+            // err / m, underestimated as in barrett::divide (small products)
+            num units = product<Mul>(err >> (k - 1), r) >> (k + 1);
+            r += units;
+            err -= product<Mul>(m, units);
+        }
+        // (truncation leaves it a few units short)
+        while (err >= m)
+        {
+            err -= m;
+            ++r;
+        }
+        return r;
+    }
+
+
+    template<typename Mul, UInt T>
+    barrett<Mul, T>::barrett(num modulus)
+        : m(std::move(modulus))
+        , r(reciprocal<Mul>(m))
+        , k(m.bit_width())
+    {}
+
+    template<typename Mul, UInt T>
+    barrett<Mul, T>::num barrett<Mul, T>::divide(num &x) const
+    {
+        num q = product<Mul>(x >> (k - 1), r) >> (k + 1);
+        x -= product<Mul>(q, m);
+        // q is at most 2 short
+        while (x >= m)
+        {
+            x -= m;
+            ++q;
+        }
+        return q;
+    }
+
+    template<typename Mul, UInt T>
+    barrett<Mul, T>::num barrett<Mul, T>::mod(const num &x) const
+    {
+        if (x.bit_width() <= 2 * k)
+        {
+            return reduce(x);
+        }
+
+        // Horner's rule on chunks of whole digits, each fitting in k bits
+        constexpr size_t len = big::bitlen<T>;
+        size_t chunk = k / len;
+        num out;
+        if (chunk == 0)
+        {
+            for (size_t bit = x.bit_width(); bit-- > 0; )
+            {
+                out <<= 1;
+                if (x.bit(bit))
+                {
+                    ++out;
+                }
+                if (out >= m)
+                {
+                    out -= m;
+                }
+            }
+            return out;
+        }
+
+        size_t top = x.value.size();
+        size_t low = top - ((top - 1) % chunk + 1);
+        while (true)
+        {
+            num digits(std::vector<T>(x.value.begin() + low, x.value.begin() + top));
+            out = reduce((out << (chunk * len)) + digits);
+            if (low == 0)
+            {
+                break;
+            }
+            top = low;
+            low -= chunk;
+        }
+        return out;
+    }
+
+    template<typename Mul, UInt T>
+    barrett<Mul, T>::value_t barrett<Mul, T>::add(const value_t &a, const value_t &b) const
+    {
+        value_t s = a + b;
+        if (s >= m)
+        {
+            s -= m;
+        }
+        return s;
+    }
+    template<typename Mul, UInt T>
+    barrett<Mul, T>::value_t barrett<Mul, T>::sub(const value_t &a, const value_t &b) const
+    {
+        return a >= b ? a - b : a + (m - b);
+    }
+
+
+} // namespace big
+
+#endif//__BARRETT_H
@@ -0,0 +1,104 @@
+/* Cooperative cancellation and progress reports
+ *
+ * A computation can run under a control, installed for the current thread by
+ * a control_scope. The exponent loops in fib/ report their progress to it
+ * between bits, and stop once it is cancelled; so do products, at every level
+ * of the recursive ones (and every row of schoolbook), leaving whatever they
+ * had computed so far. A cancelled computation therefore returns soon after,
+ * with an unspecified result, and callers tell from the control (see
+ * fib_base.h).
+ *
+ * Without a control, every check is a thread-local load.
+ */
+
+#ifndef __CONTROL_H
+#define __CONTROL_H
+
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <functional>
+
+namespace big
+{
+
+    class control
+    {
+        std::atomic<bool> stop { false };
+
+    public:
+        /* called (on the computing thread) with the estimated fraction of the
+         * work done so far
+         */
+        std::function<void(double)> progress;
+
+        /* (from any thread) */
+        void cancel() { stop.store(true, std::memory_order_relaxed); }
+        bool cancelled() const { return stop.load(std::memory_order_relaxed); }
+    };
+
+    /* installs a control for the current thread, until destroyed */
+    class control_scope
+    {
+        control *previous;
+
+    public:
+        explicit inline control_scope(control &);
+        inline ~control_scope();
+
+        control_scope(const control_scope &) = delete;
+        control_scope &operator=(const control_scope &) = delete;
+    };
+
+    /* whether the current thread's computation was cancelled */
+    inline bool cancelled();
+
+    /* from a loop over the bits of an exponent, done out of total so far:
+     * reports progress, and returns whether to stop
+     */
+    inline bool next_bit(size_t done, size_t total);
+
+    //////////////// IMPLEMENTATIONS ////////////////
+
+    inline control *&current_control()
+    {
+        thread_local control *c = nullptr;
+        return c;
+    }
+
+    control_scope::control_scope(control &c)
+        : previous(current_control())
+    {
+        current_control() = &c;
+    }
+
+    control_scope::~control_scope()
+    {
+        current_control() = previous;
+    }
+
+    bool cancelled()
+    {
+        control *c = current_control();
+        return c && c->cancelled();
+    }
+
+    bool next_bit(size_t done, size_t total)
+    {
+        control *c = current_control();
+        if (!c)
+        {
+            return false;
+        }
+        if (c->progress && total)
+        {
+            // the operands double with every bit, so with quasi-linear
+            // products, the work so far is about 2^(done - total) of the total
+            c->progress(std::exp2(static_cast<double>(done) - static_cast<double>(total)));
+        }
+        return c->cancelled();
+    }
+
+} // namespace big
+
+#endif//__CONTROL_H
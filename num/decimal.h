@@ -0,0 +1,226 @@
+/* Streaming decimal output
+ *
+ * Converts to base 10^9 (the only full-size intermediate), then writes the
+ * digits most significant first through a fixed-size buffer, so the decimal
+ * expansion is never held in memory as a whole.
+ *
+ * The conversion divides by 10^(9 L 2^l) down to leaves of L base 10^9
+ * digits, one level at a time; the divisions within a level, and then the
+ * leaves, are independent, so each level runs as one parallel loop (and
+ * every leaf fills its own fixed-width slice of the output).
+ */
+
+#ifndef __DECIMAL_H
+#define __DECIMAL_H
+
+#include "num/number.h"
+#include "num/barrett.h"
+#include "num/mulnum_karatsuba.h"
+#include "num/thread_pool.h"
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+namespace big
+{
+
+    constexpr std::uint32_t decimal_base = 1'000'000'000;
+    constexpr size_t decimal_block = 9; // digits per base 10^9 digit
+    constexpr size_t decimal_leaf = 128; // base 10^9 digits per leaf of the conversion
+    /* 32-bit digits below which a single thread is better off converting
+     * with the quadratic algorithm (about 300,000 decimal digits; measured)
+     */
+    constexpr size_t decimal_serial = 1 << 15;
+
+    /* the base 10^9 digits of x, least significant first */
+    template<typename Mul=karatsuba::cutoff_backend<>, UInt T>
+    inline std::vector<std::uint32_t> decimal_blocks(const num_t<T> &, thread_pool &pool=thread_pool::shared());
+
+    /* writes x in decimal (and returns whether everything was written) */
+    template<UInt T>
+    inline bool write_decimal(std::ostream &, const num_t<T> &);
+    template<UInt T>
+    inline bool write_decimal(int fd, const num_t<T> &);
+    /* x in decimal, as a string (for when the digits are needed whole) */
+    template<UInt T>
+    inline std::string decimal_string(const num_t<T> &);
+
+    //////////////// IMPLEMENTATIONS ////////////////
+
+    /* writes the base 10^9 digits of x < 10^(9 width) to out[0, width)
+     * (quadratic, for the leaves)
+     */
+    inline void decimal_leaf_blocks(const num_t<std::uint32_t> &x, std::uint32_t *out, size_t width)
+    {
+        // Horner's rule from the most significant digit:
+        // out = out * 2^32 + digit, in base 10^9
+        std::fill(out, out + width, 0);
+        size_t used = 0;
+        for (auto rit = x.value.rbegin(); rit != x.value.rend(); ++rit)
+        {
+            std::uint64_t carry = *rit;
+            for (size_t i = 0; i < used; ++i)
+            {
+                std::uint64_t cur = static_cast<std::uint64_t>(out[i]) << 32 | carry;
+                out[i] = static_cast<std::uint32_t>(cur % decimal_base);
+                carry = cur / decimal_base;
+            }
+            for (; carry; carry /= decimal_base)
+            {
+                out[used++] = static_cast<std::uint32_t>(carry % decimal_base);
+            }
+        }
+    }
+
+    template<typename Mul, UInt T>
+    std::vector<std::uint32_t> decimal_blocks(const num_t<T> &x, thread_pool &pool)
+    {
+        using num = num_t<std::uint32_t>;
+
+        std::vector<num> nodes { static_cast<num>(x) };
+        if (nodes[0].value.size() < (pool.size() > 1 ? decimal_leaf : decimal_serial))
+        {
+            std::vector<std::uint32_t> out(nodes[0].value.size() * 32 / 29 + 1);
+            decimal_leaf_blocks(nodes[0], out.data(), out.size());
+            while (!out.empty() && !out.back())
+            {
+                out.pop_back();
+            }
+            return out;
+        }
+
+        // powers[l] = 10^(9 decimal_leaf 2^l), until x < powers.back()^2
+        std::vector<num> powers { 1 };
+        for (size_t i = 0; i < decimal_leaf; ++i)
+        {
+            powers[0] = product<Mul>(powers[0], num(decimal_base));
+        }
+        while (nodes[0].bit_width() > 2 * (powers.back().bit_width() - 1))
+        {
+            powers.push_back(square<Mul>(powers.back()));
+        }
+
+        // nodes[i] holds base 10^9 digits [i w, (i + 1) w), where w = decimal_leaf 2^powers.size()
+        while (!powers.empty())
+        {
+            barrett<Mul, std::uint32_t> split(std::move(powers.back()));
+            powers.pop_back();
+            std::vector<num> children(nodes.size() << 1);
+            pool.parallel_for(nodes.size(), [&](size_t i)
+                    {
+                        children[2 * i + 1] = split.divide(nodes[i]);
+                        children[2 * i] = std::move(nodes[i]);
+                    });
+            nodes = std::move(children);
+        }
+
+        std::vector<std::uint32_t> out(nodes.size() * decimal_leaf);
+        pool.parallel_for(nodes.size(), [&](size_t i)
+                {
+                    decimal_leaf_blocks(nodes[i], out.data() + i * decimal_leaf, decimal_leaf);
+                });
+        while (!out.empty() && !out.back())
+        {
+            out.pop_back();
+        }
+        return out;
+    }
+
+    /* streams the digits of x to sink(const char *, size_t) -> bool */
+    template<UInt T, typename Sink>
+    inline bool write_decimal_to(const num_t<T> &x, Sink &&sink)
+    {
+        std::vector<std::uint32_t> blocks = decimal_blocks(x);
+        if (blocks.empty())
+        {
+            return sink("0", 1);
+        }
+
+        std::array<char, 1 << 16> buffer;
+        size_t used = 0;
+
+        // the leading block is not zero-padded
+        auto rit = blocks.rbegin();
+        char lead[decimal_block];
+        size_t len = 0;
+        for (std::uint32_t b = *rit; b; b /= 10)
+        {
+            lead[decimal_block - ++len] = static_cast<char>('0' + b % 10);
+        }
+        std::copy(lead + decimal_block - len, lead + decimal_block, buffer.begin());
+        used = len;
+
+        for (++rit; rit != blocks.rend(); ++rit)
+        {
+            if (used + decimal_block > buffer.size())
+            {
+                if (!sink(buffer.data(), used))
+                {
+                    return false;
+                }
+                used = 0;
+            }
+            std::uint32_t b = *rit;
+            for (size_t i = decimal_block; i-- > 0; b /= 10)
+            {
+                buffer[used + i] = static_cast<char>('0' + b % 10);
+            }
+            used += decimal_block;
+        }
+        return sink(buffer.data(), used);
+    }
+
+    template<UInt T>
+    bool write_decimal(std::ostream &out, const num_t<T> &x)
+    {
+        return write_decimal_to(x, [&out](const char *data, size_t size)
+                {
+                    return static_cast<bool>(out.write(data, static_cast<std::streamsize>(size)));
+                });
+    }
+
+    template<UInt T>
+    bool write_decimal(int fd, const num_t<T> &x)
+    {
+        return write_decimal_to(x, [fd](const char *data, size_t size)
+                {
+                    while (size)
+                    {
+                        ssize_t written = ::write(fd, data, size);
+                        if (written < 0)
+                        {
+                            if (errno == EINTR)
+                            {
+                                continue;
+                            }
+                            return false;
+                        }
+                        data += written;
+                        size -= static_cast<size_t>(written);
+                    }
+                    return true;
+                });
+    }
+
+    template<UInt T>
+    std::string decimal_string(const num_t<T> &x)
+    {
+        std::string out;
+        write_decimal_to(x, [&out](const char *data, size_t size)
+                {
+                    out.append(data, size);
+                    return true;
+                });
+        return out;
+    }
+
+} // namespace big
+
+#endif//__DECIMAL_H
@@ -0,0 +1,149 @@
+/* Fixed-width integers on the stack
+ *
+ * N 64-bit limbs in a std::array, with arithmetic modulo 2^(64 N): no
+ * allocation, no size bookkeeping, and loops over compile-time bounds
+ * (unrolled through index sequences), for numbers known to stay small.
+ */
+
+#ifndef __FIXED_H
+#define __FIXED_H
+
+#include "num/number.h"
+
+#include <array>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace big
+{
+
+    template<size_t N>
+    struct fixed_t
+    {
+        using u128 = unsigned __int128;
+
+        std::array<std::uint64_t, N> value {};
+
+        constexpr fixed_t() {}
+        constexpr fixed_t(std::uint64_t x) { value[0] = x; }
+        /* x mod 2^(64 N) */
+        template<size_t M>
+        explicit constexpr inline fixed_t(const fixed_t<M> &);
+
+        /* x mod 2^(64 N) */
+        explicit inline fixed_t(const num_t<std::uint64_t> &);
+        explicit inline operator num_t<std::uint64_t>() const;
+
+        constexpr inline fixed_t &operator+=(const fixed_t &);
+        constexpr inline fixed_t &operator-=(const fixed_t &);
+    };
+
+    template<size_t N>
+    constexpr inline fixed_t<N> operator+(fixed_t<N>, const fixed_t<N> &);
+    template<size_t N>
+    constexpr inline fixed_t<N> operator-(fixed_t<N>, const fixed_t<N> &);
+    /* the low N limbs of the product */
+    template<size_t N>
+    constexpr inline fixed_t<N> operator*(const fixed_t<N> &, const fixed_t<N> &);
+
+    //////////////// IMPLEMENTATIONS ////////////////
+
+    /* f(std::integral_constant<size_t, i>) for i = 0, ..., N - 1 */
+    template<size_t N, typename F>
+    constexpr void unroll(F &&f)
+    {
+        [&]<size_t... I>(std::index_sequence<I...>)
+        {
+            (f(std::integral_constant<size_t, I>{}), ...);
+        }(std::make_index_sequence<N>{});
+    }
+
+    template<size_t N>
+    template<size_t M>
+    constexpr fixed_t<N>::fixed_t(const fixed_t<M> &x)
+    {
+        for (size_t i = 0; i < N && i < M; ++i)
+        {
+            value[i] = x.value[i];
+        }
+    }
+
+    template<size_t N>
+    fixed_t<N>::fixed_t(const num_t<std::uint64_t> &x)
+    {
+        for (size_t i = 0; i < N && i < x.value.size(); ++i)
+        {
+            value[i] = x.value[i];
+        }
+    }
+
+    template<size_t N>
+    fixed_t<N>::operator num_t<std::uint64_t>() const
+    {
+        return std::vector<std::uint64_t>(value.begin(), value.end());
+    }
+
+    template<size_t N>
+    constexpr fixed_t<N> &fixed_t<N>::operator+=(const fixed_t &other)
+    {
+        bool carry = false;
+        unroll<N>([&](auto i)
+                {
+                    std::uint64_t sum = value[i] + other.value[i];
+                    bool overflow = sum < value[i];
+                    value[i] = sum + carry;
+                    carry = overflow || value[i] < sum;
+                });
+        return *this;
+    }
+
+    template<size_t N>
+    constexpr fixed_t<N> &fixed_t<N>::operator-=(const fixed_t &other)
+    {
+        bool borrow = false;
+        unroll<N>([&](auto i)
+                {
+                    std::uint64_t diff = value[i] - other.value[i];
+                    bool underflow = value[i] < other.value[i];
+                    value[i] = diff - borrow;
+                    borrow = underflow || diff < static_cast<std::uint64_t>(borrow);
+                });
+        return *this;
+    }
+
+    template<size_t N>
+    constexpr fixed_t<N> operator+(fixed_t<N> a, const fixed_t<N> &b)
+    {
+        return a += b;
+    }
+
+    template<size_t N>
+    constexpr fixed_t<N> operator-(fixed_t<N> a, const fixed_t<N> &b)
+    {
+        return a -= b;
+    }
+
+    template<size_t N>
+    constexpr fixed_t<N> operator*(const fixed_t<N> &a, const fixed_t<N> &b)
+    {
+        using u128 = fixed_t<N>::u128;
+
+        // schoolbook, dropping every partial product past limb N - 1
+        fixed_t<N> out;
+        unroll<N>([&](auto i)
+                {
+                    std::uint64_t carry = 0;
+                    for (size_t j = 0; i + j < N; ++j)
+                    {
+                        u128 cur = static_cast<u128>(a.value[i]) * b.value[j] + out.value[i + j] + carry;
+                        out.value[i + j] = static_cast<std::uint64_t>(cur);
+                        carry = static_cast<std::uint64_t>(cur >> 64);
+                    }
+                });
+        return out;
+    }
+
+} // namespace big
+
+#endif//__FIXED_H
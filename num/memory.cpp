@@ -0,0 +1,101 @@
+/* The allocation counting behind num/memory.h
+ *
+ * Replaces the global operator new and delete (every form that allocates on
+ * its own: plain, aligned and nothrow; array forms go through these), so
+ * that every allocation is counted with its usable size, once counting has
+ * started (see memory::start_counting; until then, only a flag is checked).
+ * Only the binaries that report memory link this in (eval.cpp and
+ * fibsonicci.cpp, see the Makefile); in any other, allocations are not
+ * counted, and allocated() stays at zero.
+ */
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+#include <malloc.h>
+
+#include "num/memory.h"
+#include "num/profile.h"
+
+namespace
+{
+
+    /* (nullptr if out of memory) */
+    void *allocate(std::size_t size, std::size_t alignment)
+    {
+        size = size ? size : 1;
+        void *p = alignment > alignof(std::max_align_t)
+            ? std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment)
+            : std::malloc(size);
+        if (p)
+        {
+            if (big::memory::counting.load(std::memory_order_relaxed))
+            {
+                big::memory::track(malloc_usable_size(p));
+            }
+            PROFILE_ALLOC(size);
+        }
+        return p;
+    }
+
+    void release(void *p)
+    {
+        if (p && big::memory::counting.load(std::memory_order_relaxed))
+        {
+            big::memory::untrack(malloc_usable_size(p));
+        }
+        std::free(p);
+    }
+
+} // namespace
+
+void *operator new(std::size_t size)
+{
+    void *p = allocate(size, alignof(std::max_align_t));
+    if (!p)
+    {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void *operator new(std::size_t size, std::align_val_t alignment)
+{
+    void *p = allocate(size, static_cast<std::size_t>(alignment));
+    if (!p)
+    {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept
+{
+    return allocate(size, alignof(std::max_align_t));
+}
+
+void *operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t &) noexcept
+{
+    return allocate(size, static_cast<std::size_t>(alignment));
+}
+
+void operator delete(void *p) noexcept
+{
+    release(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept
+{
+    release(p);
+}
+
+void operator delete(void *p, std::align_val_t) noexcept
+{
+    release(p);
+}
+
+void operator delete(void *p, std::size_t, std::align_val_t) noexcept
+{
+    release(p);
+}
@@ -0,0 +1,172 @@
+/* Memory accounting, and a memory budget
+ *
+ * In binaries linked with num/memory.cpp, once start_counting has been
+ * called (for --memory or --max-memory), every allocation through operator
+ * new is counted (with its usable size, from malloc_usable_size), so the
+ * bytes currently allocated, and their high-water mark, are known (before
+ * that, or elsewhere, both stay at zero, and allocations cost no more than
+ * a flag check); the high-water mark of the resident set comes from
+ * /proc/self/status. Both marks can be reset, to measure one computation at
+ * a time.
+ *
+ * With a budget set (--max-memory), backends check whether their scratch
+ * space fits before allocating it, and fall back to leaner strategies when
+ * it does not (see num/mulnum_fft.h).
+ */
+
+#ifndef __MEMORY_H
+#define __MEMORY_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <string_view>
+
+namespace big::memory
+{
+
+    /* bytes allocated through operator new, now and at most since the last reset
+     * (counted by num/memory.cpp)
+     */
+    inline size_t allocated();
+    inline size_t peak_allocated();
+    /* the resident set's high-water mark in bytes (0 if unknown) */
+    inline size_t peak_resident();
+    inline void reset_peak();
+    /* counts allocations from now on (before the computations to measure) */
+    inline void start_counting();
+
+    /* in bytes (0 for no budget) */
+    inline size_t &budget();
+    /* whether bytes more would stay within the budget */
+    inline bool fits(size_t bytes);
+
+    /* "512K", "64M", "2G" or plain bytes (0 if malformed or too large) */
+    inline size_t parse_size(std::string_view);
+    /* "12.3 MiB" */
+    inline std::string format_size(size_t);
+
+    //////////////// IMPLEMENTATIONS ////////////////
+
+    // (constant-initialised, so counting works during static initialisation;
+    // signed, as blocks allocated before counting started may be freed after)
+    inline constinit std::atomic<bool> counting { false };
+    inline constinit std::atomic<std::ptrdiff_t> live { 0 };
+    inline constinit std::atomic<std::ptrdiff_t> peak { 0 };
+
+    /* (from num/memory.cpp, while counting) */
+    inline void track(size_t bytes)
+    {
+        std::ptrdiff_t size = static_cast<std::ptrdiff_t>(bytes);
+        std::ptrdiff_t now = live.fetch_add(size, std::memory_order_relaxed) + size;
+        std::ptrdiff_t high = peak.load(std::memory_order_relaxed);
+        while (now > high && !peak.compare_exchange_weak(high, now, std::memory_order_relaxed))
+        {
+        }
+    }
+
+    inline void untrack(size_t bytes)
+    {
+        live.fetch_sub(static_cast<std::ptrdiff_t>(bytes), std::memory_order_relaxed);
+    }
+
+    size_t allocated()
+    {
+        return static_cast<size_t>(std::max<std::ptrdiff_t>(live.load(std::memory_order_relaxed), 0));
+    }
+
+    size_t peak_allocated()
+    {
+        return static_cast<size_t>(std::max<std::ptrdiff_t>(peak.load(std::memory_order_relaxed), 0));
+    }
+
+    size_t peak_resident()
+    {
+        std::FILE *status = std::fopen("/proc/self/status", "r");
+        if (!status)
+        {
+            return 0;
+        }
+        char line[128];
+        unsigned long kib = 0;
+        while (std::fgets(line, sizeof line, status))
+        {
+            if (std::sscanf(line, "VmHWM: %lu kB", &kib) == 1)
+            {
+                break;
+            }
+        }
+        std::fclose(status);
+        return kib * 1024;
+    }
+
+    void reset_peak()
+    {
+        peak.store(live.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        // (5 resets VmHWM; older kernels just keep the process-wide mark)
+        if (std::FILE *refs = std::fopen("/proc/self/clear_refs", "w"))
+        {
+            std::fputs("5", refs);
+            std::fclose(refs);
+        }
+    }
+
+    void start_counting()
+    {
+        counting.store(true, std::memory_order_relaxed);
+    }
+
+    size_t &budget()
+    {
+        static size_t bytes = 0;
+        return bytes;
+    }
+
+    bool fits(size_t bytes)
+    {
+        return !budget() || allocated() + bytes <= budget();
+    }
+
+    size_t parse_size(std::string_view s)
+    {
+        size_t bytes = 0;
+        size_t i = 0;
+        for (; i < s.size() && s[i] >= '0' && s[i] <= '9'; ++i)
+        {
+            size_t digit = static_cast<size_t>(s[i] - '0');
+            if (bytes > (SIZE_MAX - digit) / 10)
+            {
+                return 0;
+            }
+            bytes = bytes * 10 + digit;
+        }
+        if (i == 0 || i + 1 < s.size())
+        {
+            return 0;
+        }
+        unsigned shift;
+        switch (i < s.size() ? s[i] : 'B')
+        {
+        case 'G': case 'g': shift = 30; break;
+        case 'M': case 'm': shift = 20; break;
+        case 'K': case 'k': shift = 10; break;
+        case 'B': case 'b': shift = 0; break;
+        default: return 0;
+        }
+        // (rejected, rather than wrapped around to some other budget)
+        return bytes > (SIZE_MAX >> shift) ? 0 : bytes << shift;
+    }
+
+    std::string format_size(size_t bytes)
+    {
+        char out[32];
+        std::snprintf(out, sizeof out, "%.1f MiB", static_cast<double>(bytes) / (1 << 20));
+        return out;
+    }
+
+} // namespace big::memory
+
+#endif//__MEMORY_H
@@ -1,5 +1,5 @@
-#ifndef __MUL_H
-#define __MUL_H
+#ifndef __MULNUM_DFT_H
+#define __MULNUM_DFT_H
 
 #include "num/number.h"
 
@@ -7,10 +7,18 @@
 #include <complex>
 #include <cmath>
 
-namespace big
+namespace big::dft
 {
 
     inline num_t<std::uint8_t> operator*(const num_t<std::uint8_t> &, const num_t<std::uint8_t> &);
+    inline num_t<std::uint8_t> square(const num_t<std::uint8_t> &);
+
+    /* multiplication backend (for the generic engines in fib/) */
+    struct backend
+    {
+        static num_t<std::uint8_t> mul(const num_t<std::uint8_t> &lhs, const num_t<std::uint8_t> &rhs) { return lhs * rhs; }
+        static num_t<std::uint8_t> sqr(const num_t<std::uint8_t> &x) { return square(x); }
+    };
 
     //////////////// IMPLEMENTATIONS ////////////////
 
@@ -92,6 +100,11 @@ namespace big
         complex omega(1);
         for (size_t k = 0; k < x.size(); ++k)
         {
+            if (cancelled())
+            {
+                f.resize(x.size());
+                break;
+            }
             complex coef(1);
             complex sum;
             for (size_t n = 0; n < x.size(); ++n)
@@ -134,8 +147,25 @@ namespace big
         DB({ num_t z(fold(from_complex(dft<dft_t::inverse>(lh)))); cerr << lhs.str(true) << " * " << rhs.str(true) << " == " << z.str(true) << endl; });
         return num_t(fold(from_complex(dft<dft_t::inverse>(lh))));
     }
+
+    /* only needs one forward transform */
+    num_t<std::uint8_t> square(const num_t<std::uint8_t> &x)
+    {
+        std::vector<complex> xc = to_complex(x.value);
+        xc.resize(x.value.size() << 1);
+
+        std::vector<complex> xh = dft(xc);
+
+        for (auto &xi : xh)
+        {
+            xi *= xi;
+        }
+
+        DB({ num_t z(fold(from_complex(dft<dft_t::inverse>(xh)))); cerr << x.str(true) << " ** 2 == " << z.str(true) << endl; });
+        return num_t(fold(from_complex(dft<dft_t::inverse>(xh))));
+    }
     
-} // namespace big
+} // namespace big::dft
 
 
-#endif//__MUL_H
+#endif//__MULNUM_DFT_H
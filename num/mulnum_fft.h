@@ -1,16 +1,36 @@
-#ifndef __MUL_H
-#define __MUL_H
+#ifndef __MULNUM_FFT_H
+#define __MULNUM_FFT_H
 
 #include "num/number.h"
+#include "num/mulnum_karatsuba.h"
 
 #include <algorithm>
+#include <bit>
 #include <complex>
 #include <cmath>
 
-namespace big
+namespace big::fft
 {
 
     inline num_t<std::uint8_t> operator*(const num_t<std::uint8_t> &, const num_t<std::uint8_t> &);
+    inline num_t<std::uint8_t> square(const num_t<std::uint8_t> &);
+
+    /* the same product (of lhs and *rhs, or lhs squared if rhs is null) in
+     * less memory: padded only to the product's size, transformed in place,
+     * and rounded straight into digits (or, if even that exceeds the memory
+     * budget, multiplied with Karatsuba instead)
+     *
+     * (operator* and square switch to this when their own scratch space would
+     * exceed the budget, see num/memory.h)
+     */
+    inline num_t<std::uint8_t> lean_product(const num_t<std::uint8_t> &lhs, const num_t<std::uint8_t> *rhs);
+
+    /* multiplication backend (for the generic engines in fib/) */
+    struct backend
+    {
+        static num_t<std::uint8_t> mul(const num_t<std::uint8_t> &lhs, const num_t<std::uint8_t> &rhs) { return lhs * rhs; }
+        static num_t<std::uint8_t> sqr(const num_t<std::uint8_t> &x) { return square(x); }
+    };
 
     //////////////// IMPLEMENTATIONS ////////////////
 
@@ -103,6 +123,42 @@ namespace big
         return out;
     }
 
+    /* bit_reverse_shuffle, in place (for a power-of-2 size) */
+    inline void bit_reverse_permute(std::vector<complex> &x)
+    {
+        for (size_t i = 0, ri = 0; i < x.size(); ++i, inc_rev(ri, x.size()))
+        {
+            if (i < ri)
+            {
+                std::swap(x[i], x[ri]);
+            }
+        }
+    }
+
+    /* fold(from_complex(x)), without the intermediate vector, over the first
+     * len coefficients (the others are zero)
+     */
+    inline std::vector<std::uint8_t> fold(const std::vector<complex> &x, size_t len)
+    {
+        using std::uint8_t;
+        using std::uint64_t;
+        uint64_t spill = 0;
+        std::vector<uint8_t> out;
+        out.reserve(len+8);
+        for (size_t i = 0; i < len && i < x.size(); ++i)
+        {
+            uint64_t sum = static_cast<uint64_t>(std::round(x[i].real())) + spill;
+            out.emplace_back(static_cast<uint8_t>(sum));
+            spill = sum >> 8;
+        }
+        while (spill)
+        {
+            out.emplace_back(static_cast<uint8_t>(spill));
+            spill >>= 8;
+        }
+        return out;
+    }
+
     enum class dft_t
     {
         normal = 0,
@@ -121,6 +177,11 @@ namespace big
             complex omega = primitive_root<dft_type==dft_t::normal>(m);
             for (size_t k = 0; k < x.size(); k += m)
             {
+                if (k % (1 << 16) == 0 && cancelled())
+                {
+                    // (every 2^16 points, as a pass over a large transform takes a while)
+                    return;
+                }
                 complex coef(1);
                 size_t m2 = m >> 1;
                 for (size_t j = 0; j < m2; ++j)
@@ -145,6 +206,10 @@ namespace big
     num_t<std::uint8_t> operator*(const num_t<std::uint8_t> &lhs, const num_t<std::uint8_t> &rhs)
     {
         size_t size = pow2ceil(std::max(lhs.value.size(), rhs.value.size()) << 1);
+        if (!memory::fits(3 * size * sizeof(complex)))
+        {
+            return lean_product(lhs, &rhs);
+        }
         std::vector<complex> lc = bit_reverse_shuffle(lhs.value, size);
         std::vector<complex> rc = bit_reverse_shuffle(rhs.value, size);
 
@@ -162,8 +227,69 @@ namespace big
         DB({ num_t z(fold(from_complex(conv))); cerr << lhs.str(true) << " * " << rhs.str(true) << " == " << z.str(true) << endl; });
         return num_t(fold(from_complex(conv)));
     }
+
+    /* only needs one forward transform */
+    num_t<std::uint8_t> square(const num_t<std::uint8_t> &x)
+    {
+        size_t size = pow2ceil(x.value.size() << 1);
+        if (!memory::fits(2 * size * sizeof(complex)))
+        {
+            return lean_product(x, nullptr);
+        }
+        std::vector<complex> xc = bit_reverse_shuffle(x.value, size);
+
+        fft(xc);
+
+        for (auto &xi : xc)
+        {
+            xi *= xi;
+        }
+
+        std::vector<complex> conv = bit_reverse_shuffle(xc, size);
+        fft<dft_t::inverse>(conv);
+
+        DB({ num_t z(fold(from_complex(conv))); cerr << x.str(true) << " ** 2 == " << z.str(true) << endl; });
+        return num_t(fold(from_complex(conv)));
+    }
+
+    num_t<std::uint8_t> lean_product(const num_t<std::uint8_t> &lhs, const num_t<std::uint8_t> *rhs)
+    {
+        size_t len = lhs.value.size() + (rhs ? rhs->value.size() : lhs.value.size());
+        size_t size = std::bit_ceil(len);
+        if (!memory::fits((rhs ? 2 : 1) * size * sizeof(complex)))
+        {
+            // a few copies of the operands, in 32-bit digits
+            num_t<std::uint32_t> l = static_cast<num_t<std::uint32_t>>(lhs);
+            return static_cast<num_t<std::uint8_t>>(rhs
+                    ? karatsuba::backend::mul(l, static_cast<num_t<std::uint32_t>>(*rhs))
+                    : karatsuba::backend::sqr(l));
+        }
+
+        std::vector<complex> lc = bit_reverse_shuffle(lhs.value, size);
+        fft(lc);
+        if (rhs)
+        {
+            std::vector<complex> rc = bit_reverse_shuffle(rhs->value, size);
+            fft(rc);
+            for (size_t i = 0; i < size; ++i)
+            {
+                lc[i] *= rc[i];
+            }
+        }
+        else
+        {
+            for (auto &xi : lc)
+            {
+                xi *= xi;
+            }
+        }
+
+        bit_reverse_permute(lc);
+        fft<dft_t::inverse>(lc);
+        return num_t(fold(lc, len));
+    }
     
-} // namespace big
+} // namespace big::fft
 
 
-#endif//__MUL_H
+#endif//__MULNUM_FFT_H
@@ -1,19 +1,43 @@
-#ifndef __MUL_H
-#define __MUL_H
+#ifndef __MULNUM_KARATSUBA_H
+#define __MULNUM_KARATSUBA_H
 
 #include "num/number.h"
+#include "num/mulnum_simple.h"
 
 #include <algorithm>
 
-namespace big
+namespace big::karatsuba
 {
 
-    template<typename T>
-    concept SmallUInt = UInt<T> && not std::is_same<T, std::uint64_t>::value;
-
     template<SmallUInt T>
     inline num_t<T> operator*(const num_t<T> &, const num_t<T> &);
 
+    /* recurses until either operand is at most cutoff digits long, then
+     * switches to schoolbook multiplication
+     * (operator* recurses all the way down, as in the video)
+     */
+    template<size_t cutoff, SmallUInt T>
+    inline num_t<T> multiply(const num_t<T> &, const num_t<T> &);
+
+    /* multiplication backend (for the generic engines in fib/) */
+    struct backend
+    {
+        template<SmallUInt T>
+        static num_t<T> mul(const num_t<T> &lhs, const num_t<T> &rhs) { return lhs * rhs; }
+        template<SmallUInt T>
+        static num_t<T> sqr(const num_t<T> &x) { return x * x; }
+    };
+
+    /* same, with a schoolbook base case (for internal uses, e.g. num/decimal.h) */
+    template<size_t cutoff=32>
+    struct cutoff_backend
+    {
+        template<SmallUInt T>
+        static num_t<T> mul(const num_t<T> &lhs, const num_t<T> &rhs) { return multiply<cutoff>(lhs, rhs); }
+        template<SmallUInt T>
+        static num_t<T> sqr(const num_t<T> &x) { return multiply<cutoff>(x, x); }
+    };
+
 
     //////////////// IMPLEMENTATIONS ////////////////
 
@@ -46,13 +70,24 @@ namespace big
      *
      * assumes also that the scratch space is at least six times the 
      */
-    template<SmallUInt T, bool cleanup=false>
+    template<SmallUInt T, bool cleanup=false, size_t cutoff=0>
     inline void mul(const digit_range<T> &out, const const_digit_range<T> &lhs, const const_digit_range<T> &rhs, const digit_range<T> &scratch)
     {
         if (lhs.empty() || rhs.empty())
         {
             return;
         }
+        if (std::max(lhs.size(), rhs.size()) >= 64 && cancelled())
+        {
+            // (smaller products finish soon enough)
+            return;
+        }
+        if (std::min(lhs.size(), rhs.size()) <= cutoff)
+        {
+            // (the output is zeroed, as below)
+            simple::mul<T>(out, lhs, rhs);
+            return;
+        }
         if (rhs.size() == 1)
         {
             mul_scalar<T>(out, lhs, *rhs.begin());
@@ -126,18 +161,18 @@ namespace big
         }
 
         digit_range<T> workspace(shi, scratch.end());
-        mul<T, true>(z3, lhs_loup, rhs_loup, workspace);
+        mul<T, true, cutoff>(z3, lhs_loup, rhs_loup, workspace);
         
         // z0 = x0 * y0
         // (we can put z0 in the output first)
         auto out_mid = std::next(out.begin(), halfsize<<1);
         digit_range<T> z0(out.begin(), out_mid);
-        mul<T, true>(z0, lhs_lower, rhs_lower, workspace);
+        mul<T, true, cutoff>(z0, lhs_lower, rhs_lower, workspace);
 
         // z2 = x1 * y1
         // (we can also put this in the output, thanks to alignment)
         digit_range<T> z2(out_mid, out.end());
-        mul<T, true>(z2, lhs_upper, rhs_upper, workspace);
+        mul<T, true, cutoff>(z2, lhs_upper, rhs_upper, workspace);
 
         // z1 = z3 - z2 - z0
         // no underflows possible
@@ -156,27 +191,32 @@ namespace big
         //      = (z0 + (z2 << half*2)) + (z1 << half)
 
         digit_range<T> z0z2_shifted(std::next(out.begin(), halfsize), out.end());
-        if (z0z2_shifted.size() >= z3.size())
-        {
-            add<T>(z0z2_shifted, z0z2_shifted, z3);
-        }
-        else
+        if (z3.size() > z0z2_shifted.size())
         {
-            add<T>(z0z2_shifted, z3, z0z2_shifted);
+            // z1 < prod >> half, so the digits of z3 past the output are zero
+            // (only happens with unbalanced operands)
+            z3.end_ = std::next(z3.begin(), z0z2_shifted.size());
         }
+        add<T>(z0z2_shifted, z0z2_shifted, z3);
     }
 
-    template<SmallUInt T>
-    num_t<T> operator*(const num_t<T> &lhs, const num_t<T> &rhs)
+    template<size_t cutoff, SmallUInt T>
+    num_t<T> multiply(const num_t<T> &lhs, const num_t<T> &rhs)
     {
         size_t maxsize = std::max(lhs.value.size(), rhs.value.size());
         std::vector<T> out((maxsize+1) << 1);
         std::vector<T> scratch(out.size() << 3); // conservative allocation for scratch memory
-        mul<T>(digit_range<T>(out), const_digit_range<T>(lhs.value), const_digit_range<T>(rhs.value), digit_range<T>(scratch));
+        mul<T, false, cutoff>(digit_range<T>(out), const_digit_range<T>(lhs.value), const_digit_range<T>(rhs.value), digit_range<T>(scratch));
         DB({ num_t<T> res { out }; cerr << lhs.str(true) << " * " << rhs.str(true) << " == " << res.str(true) << endl; });
         return { out };
     }
 
-} // namespace big
+    template<SmallUInt T>
+    num_t<T> operator*(const num_t<T> &lhs, const num_t<T> &rhs)
+    {
+        return multiply<0>(lhs, rhs);
+    }
+
+} // namespace big::karatsuba
 
-#endif//__MUL_H
+#endif//__MULNUM_KARATSUBA_H
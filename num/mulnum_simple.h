@@ -1,17 +1,23 @@
-#ifndef __MUL_H
-#define __MUL_H
+#ifndef __MULNUM_SIMPLE_H
+#define __MULNUM_SIMPLE_H
 
 #include "num/number.h"
 
-namespace big
+namespace big::simple
 {
 
-    template<typename T>
-    concept SmallUInt = UInt<T> && not std::is_same<T, std::uint64_t>::value;
-
     template<SmallUInt T>
     inline num_t<T> operator*(const num_t<T> &, const num_t<T> &);
 
+    /* multiplication backend (for the generic engines in fib/) */
+    struct backend
+    {
+        template<SmallUInt T>
+        static num_t<T> mul(const num_t<T> &lhs, const num_t<T> &rhs) { return lhs * rhs; }
+        template<SmallUInt T>
+        static num_t<T> sqr(const num_t<T> &x) { return x * x; }
+    };
+
     //////////////// IMPLEMENTATIONS ////////////////
 
     /* assumes out length is at least one more than the input length
@@ -63,8 +69,12 @@ namespace big
     {
         auto rit = rhs.begin();
         digit_range<T> owindow(out);
-        for (; rit != rhs.end(); ++rit, ++owindow.begin_)
+        for (size_t row = 0; rit != rhs.end(); ++rit, ++owindow.begin_, ++row)
         {
+            if (row % 64 == 63 && cancelled())
+            {
+                return;
+            }
             // no need for safe checks because out is assumed to be large enough
             muladd<T, false>(owindow, lhs, *rit);
         }
@@ -83,6 +93,6 @@ namespace big
         return { out };
     }
 
-} // namespace big
+} // namespace big::simple
 
-#endif//__MUL_H
+#endif//__MULNUM_SIMPLE_H
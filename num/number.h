@@ -4,7 +4,9 @@
 #ifndef __NUM_H
 #define __NUM_H
 
+#include <algorithm>
 #include <cmath>
+#include <bit>
 #include <climits>
 #include <cstdint>
 #include <compare>
@@ -17,6 +19,11 @@
 #include <utility>
 #include <vector>
 
+#include "num/control.h"
+#include "num/memory.h"
+#include "num/perf.h"
+#include "num/profile.h"
+
 #ifdef DEBUG
 #include <iostream>
 #include <iomanip>
@@ -34,6 +41,9 @@ namespace big
     concept UInt = std::unsigned_integral<T>;
     template<typename T>
     concept Int = std::integral<T>;
+    /* limbs narrow enough for products to be accumulated in 64 bits */
+    template<typename T>
+    concept SmallUInt = UInt<T> && not std::is_same<T, std::uint64_t>::value;
 
     using std::size_t;
 
@@ -62,6 +72,13 @@ namespace big
         inline num_t(const std::vector<T> &v) : value(v) { full_reduce(); }
         inline num_t(std::vector<T> &&v) : value(std::move(v)) { full_reduce(); }
 
+#ifdef PROFILE
+        inline num_t(const num_t &other) : value(other.value) { PROFILE_COPY(value.size() * sizeof(T)); }
+        inline num_t(num_t &&) = default;
+        inline num_t &operator=(const num_t &other) { value = other.value; PROFILE_COPY(value.size() * sizeof(T)); return *this; }
+        inline num_t &operator=(num_t &&) = default;
+#endif
+
         inline num_t &operator++();
         inline num_t &operator--();
         inline num_t operator++(int);
@@ -85,6 +102,8 @@ namespace big
         explicit inline operator long double() const;
         std::string str(bool=false) const;
         T residue() const;
+        size_t bit_width() const;
+        bool bit(size_t) const;
 
         inline void reduce_once();
         inline void full_reduce();
@@ -125,6 +144,12 @@ namespace big
     template<UInt T, Int I>
     inline bool operator==(const num_t<T> &, const I);
 
+    /* multiplies via a backend (see num/mulnum_*.h) */
+    template<typename Mul, UInt T>
+    inline num_t<T> product(const num_t<T> &, const num_t<T> &);
+    template<typename Mul, UInt T>
+    inline num_t<T> square(const num_t<T> &);
+
     //////////////// IMPLEMENTATIONS ////////////////
 
     template<typename Iterator>
@@ -195,7 +220,7 @@ namespace big
         bool borrow = true;
         for (auto it = range.begin(); borrow & it != range.end(); ++it)
         {
-            borrow = (*it)--;
+            borrow = !(*it)--;
         }
         return borrow;
     }
@@ -301,6 +326,16 @@ namespace big
     template<UInt T>
     inline T lshift(const digit_range<T> &out, const const_digit_range<T> &src, size_t bits)
     {
+        if (bits == 0)
+        {
+            // (shifting a full-width digit by bitlen<T> is undefined)
+            auto oit = out.begin();
+            for (auto it = src.begin(); it != src.end(); ++it, ++oit)
+            {
+                *oit = *it;
+            }
+            return 0;
+        }
         T spill = 0;
         auto oit = out.begin();
         for (auto it = src.begin(); it != src.end(); ++it, ++oit)
@@ -318,6 +353,15 @@ namespace big
     template<UInt T>
     inline T rshift(const digit_range<T> &out, const const_digit_range<T> &src, size_t bits)
     {
+        if (bits == 0)
+        {
+            auto oit = out.begin();
+            for (auto it = src.begin(); it != src.end(); ++it, ++oit)
+            {
+                *oit = *it;
+            }
+            return 0;
+        }
         T spill = 0;
         auto orit = out.rbegin();
         for (auto rit = src.rbegin(); rit != src.rend(); ++rit, ++orit)
@@ -664,6 +708,19 @@ namespace big
         return value.empty() ? 0 : value[0];
     }
 
+    template<UInt T>
+    size_t num_t<T>::bit_width() const
+    {
+        if (value.empty()) { return 0; }
+        return ((value.size() - 1) << bitlog<T>) + std::bit_width(*value.rbegin());
+    }
+    template<UInt T>
+    bool num_t<T>::bit(size_t i) const
+    {
+        size_t digit = i >> bitlog<T>;
+        return digit < value.size() && ((value[digit] >> (i & (bitlen<T> - 1))) & 1);
+    }
+
     template<UInt T>
     void num_t<T>::reduce_once()
     {
@@ -685,6 +742,7 @@ namespace big
     template<UInt S>
     num_t<T>::operator num_t<S>() const
     {
+        PERF_SCOPE("limb conversion");
         constexpr size_t lenT = bitlen<T>;
         constexpr size_t lenS = bitlen<S>;
         if constexpr(lenT > lenS)
@@ -802,6 +860,29 @@ namespace big
         return lhs == num_t<T>(n);
     }
 
+    template<typename Mul, UInt T>
+    num_t<T> product(const num_t<T> &lhs, const num_t<T> &rhs)
+    {
+        PERF_SCOPE_AT(perf::bucket(perf::op_t::mul, bitlen<T> * std::max(lhs.value.size(), rhs.value.size())));
+        PROFILE_PRODUCT(Mul, bitlen<T> * std::max(lhs.value.size(), rhs.value.size()));
+        if (cancelled())
+        {
+            return {};
+        }
+        return Mul::mul(lhs, rhs);
+    }
+    template<typename Mul, UInt T>
+    num_t<T> square(const num_t<T> &x)
+    {
+        PERF_SCOPE_AT(perf::bucket(perf::op_t::sqr, bitlen<T> * x.value.size()));
+        PROFILE_PRODUCT(Mul, bitlen<T> * x.value.size());
+        if (cancelled())
+        {
+            return {};
+        }
+        return Mul::sqr(x);
+    }
+
 } // namespace big
 
 #endif//__NUM_H
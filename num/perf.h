@@ -0,0 +1,351 @@
+/* Hardware performance counters per phase (PERF builds only)
+ *
+ * PERF_SCOPE("name") counts cycles, instructions, L1d and last-level cache
+ * read misses, and branch mispredictions (through perf_event_open), along
+ * with the wall time, from there to the end of the enclosing block, and adds
+ * them to the phase called "name". Phases nest, and are inclusive of their
+ * inner phases. Counters are per thread (each thread opens its own the
+ * first time it enters a phase, or as it starts with PERF_THREAD, like the
+ * workers of num/thread_pool.h), and the ones the kernel refuses to open
+ * (no PMU, or a high perf_event_paranoid) are reported as null.
+ *
+ * Named phases add up the counters of every thread (so that, e.g., the
+ * decimal output includes the pool's work), and are meant to be entered
+ * by one thread at a time.
+ *
+ * Each call site looks its phase up once; PERF_SCOPE_AT(phase) takes one
+ * looked up already, e.g. a size class of products from bucket, which
+ * skips the small products altogether (reading the counters costs a few
+ * microseconds, more than those products themselves: their time goes to
+ * the enclosing phase instead). Those only count their own thread, as
+ * products may run on several threads at once.
+ *
+ * Without PERF, PERF_SCOPE, PERF_SCOPE_AT and PERF_THREAD expand to nothing.
+ */
+
+#ifndef __PERF_H
+#define __PERF_H
+
+#ifdef PERF
+
+#include <array>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#define PERF_CAT_(A, B) A##B
+#define PERF_CAT(A, B) PERF_CAT_(A, B)
+#define PERF_SCOPE(NAME) \
+    static ::big::perf::counts &PERF_CAT(perf_phase_, __LINE__) = ::big::perf::phase(NAME); \
+    ::big::perf::scope PERF_CAT(perf_scope_, __LINE__)(&PERF_CAT(perf_phase_, __LINE__), true)
+#define PERF_SCOPE_AT(PHASE) ::big::perf::scope PERF_CAT(perf_scope_, __LINE__)(PHASE)
+#define PERF_THREAD() ::big::perf::counters::local()
+
+namespace big::perf
+{
+
+    constexpr size_t events = 5;
+    constexpr const char *event_names[events] = { "cycles", "instructions", "l1d_misses", "llc_misses", "branch_misses" };
+
+    /* totals of one phase */
+    struct counts
+    {
+        size_t calls = 0;
+        double seconds = 0;
+        std::array<std::uint64_t, events> values {};
+    };
+
+    /* this thread's counters (those that could not be opened stay at -1) */
+    class counters
+    {
+        std::array<int, events> fds;
+
+    public:
+        inline counters();
+        inline ~counters();
+
+        bool available(size_t i) const { return fds[i] >= 0; }
+        inline std::array<std::uint64_t, events> read() const;
+
+        static inline counters &local();
+        /* the counters of every thread so far, exited ones included */
+        static inline std::array<std::uint64_t, events> every_thread();
+    };
+
+    /* counts from construction to destruction, on this thread or on all of
+     * them, added to the phase (if any)
+     */
+    class scope
+    {
+        counts *phase;
+        bool all;
+        std::array<std::uint64_t, events> start;
+        std::chrono::steady_clock::time_point start_time;
+
+        inline std::array<std::uint64_t, events> read() const;
+
+    public:
+        explicit inline scope(counts *, bool every_thread=false);
+        inline ~scope();
+
+        scope(const scope &) = delete;
+        scope &operator=(const scope &) = delete;
+    };
+
+    /* the totals of the named phase (stay put once created) */
+    inline counts &phase(const std::string &);
+
+    enum class op_t
+    {
+        mul = 0,
+        sqr = 1,
+    };
+
+    /* smallest products given a phase of their own */
+    constexpr size_t min_bucket_bits = 1 << 16;
+
+    /* the phase "op 2^k bits", for operands of 2^k to 2^(k+1) bits, or null
+     * below min_bucket_bits
+     */
+    inline counts *bucket(op_t, size_t bits);
+
+    /* every phase so far, as JSON */
+    inline void write_report(std::ostream &);
+
+    //////////////// IMPLEMENTATIONS ////////////////
+
+    struct registry
+    {
+        std::mutex lock;
+        std::map<std::string, counts> phases;
+        std::array<bool, events> available {};
+        std::vector<const counters *> threads;   // opened and not exited yet
+        std::array<std::uint64_t, events> exited {}; // totals of the others
+    };
+
+    inline registry &phases()
+    {
+        static registry r;
+        return r;
+    }
+
+    counters::counters()
+    {
+        constexpr std::uint64_t l1d_miss = PERF_COUNT_HW_CACHE_L1D
+            | PERF_COUNT_HW_CACHE_OP_READ << 8 | PERF_COUNT_HW_CACHE_RESULT_MISS << 16;
+        constexpr std::uint64_t llc_miss = PERF_COUNT_HW_CACHE_LL
+            | PERF_COUNT_HW_CACHE_OP_READ << 8 | PERF_COUNT_HW_CACHE_RESULT_MISS << 16;
+        constexpr std::pair<std::uint32_t, std::uint64_t> config[events] = {
+            { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+            { PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+            { PERF_TYPE_HW_CACHE, l1d_miss },
+            { PERF_TYPE_HW_CACHE, llc_miss },
+            { PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+        };
+
+        registry &r = phases();
+        std::lock_guard guard(r.lock);
+        for (size_t i = 0; i < events; ++i)
+        {
+            perf_event_attr attr;
+            std::memset(&attr, 0, sizeof attr);
+            attr.size = sizeof attr;
+            attr.type = config[i].first;
+            attr.config = config[i].second;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            // (scaled up if the kernel has to multiplex the counters)
+            attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+            fds[i] = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+            r.available[i] = r.available[i] || fds[i] >= 0;
+        }
+        r.threads.push_back(this);
+    }
+
+    counters::~counters()
+    {
+        {
+            registry &r = phases();
+            std::lock_guard guard(r.lock);
+            std::array<std::uint64_t, events> last = read();
+            for (size_t i = 0; i < events; ++i)
+            {
+                r.exited[i] += last[i];
+            }
+            std::erase(r.threads, this);
+        }
+        for (int fd : fds)
+        {
+            if (fd >= 0)
+            {
+                close(fd);
+            }
+        }
+    }
+
+    std::array<std::uint64_t, events> counters::read() const
+    {
+        std::array<std::uint64_t, events> out {};
+        for (size_t i = 0; i < events; ++i)
+        {
+            std::uint64_t buffer[3]; // value, time enabled, time running
+            if (fds[i] >= 0 && ::read(fds[i], buffer, sizeof buffer) == sizeof buffer && buffer[2])
+            {
+                out[i] = buffer[2] == buffer[1] ? buffer[0]
+                       : static_cast<std::uint64_t>(static_cast<double>(buffer[0]) * buffer[1] / buffer[2]);
+            }
+        }
+        return out;
+    }
+
+    counters &counters::local()
+    {
+        thread_local counters c;
+        return c;
+    }
+
+    std::array<std::uint64_t, events> counters::every_thread()
+    {
+        registry &r = phases();
+        std::lock_guard guard(r.lock);
+        std::array<std::uint64_t, events> out = r.exited;
+        for (const counters *c : r.threads)
+        {
+            std::array<std::uint64_t, events> values = c->read();
+            for (size_t i = 0; i < events; ++i)
+            {
+                out[i] += values[i];
+            }
+        }
+        return out;
+    }
+
+    scope::scope(counts *phase, bool every_thread)
+        : phase(phase)
+        , all(every_thread)
+    {
+        if (phase)
+        {
+            start = read();
+            start_time = std::chrono::steady_clock::now();
+        }
+    }
+
+    std::array<std::uint64_t, events> scope::read() const
+    {
+        // (opens this thread's counters if need be, so that it counts too)
+        counters &local = counters::local();
+        return all ? counters::every_thread() : local.read();
+    }
+
+    scope::~scope()
+    {
+        if (!phase)
+        {
+            return;
+        }
+        auto stop_time = std::chrono::steady_clock::now();
+        std::array<std::uint64_t, events> stop = read();
+
+        registry &r = phases();
+        std::lock_guard guard(r.lock);
+        counts &c = *phase;
+        ++c.calls;
+        c.seconds += std::chrono::duration<double>(stop_time - start_time).count();
+        for (size_t i = 0; i < events; ++i)
+        {
+            c.values[i] += stop[i] - start[i];
+        }
+    }
+
+    counts &phase(const std::string &name)
+    {
+        registry &r = phases();
+        std::lock_guard guard(r.lock);
+        return r.phases[name];
+    }
+
+    counts *bucket(op_t op, size_t bits)
+    {
+        if (bits < min_bucket_bits)
+        {
+            return nullptr;
+        }
+        constexpr size_t classes = 64;
+        static const auto slots = []
+        {
+            std::array<std::array<counts *, classes>, 2> out {};
+            for (size_t k = std::bit_width(min_bucket_bits) - 1; k < classes; ++k)
+            {
+                out[0][k] = &phase("mul 2^" + std::to_string(k) + " bits");
+                out[1][k] = &phase("sqr 2^" + std::to_string(k) + " bits");
+            }
+            return out;
+        }();
+        return slots[static_cast<size_t>(op)][std::bit_width(bits) - 1];
+    }
+
+    void write_report(std::ostream &out)
+    {
+        registry &r = phases();
+        std::lock_guard guard(r.lock);
+        out << "{\"phases\": [";
+        bool first = true;
+        for (const auto &[name, c] : r.phases)
+        {
+            if (c.calls == 0)
+            {
+                // (looked up, e.g. as a bucket, but never entered)
+                continue;
+            }
+            out << (first ? "\n  " : ",\n  ") << "{\"name\": \"" << name << "\", \"calls\": " << c.calls
+                << ", \"seconds\": " << c.seconds;
+            for (size_t i = 0; i < events; ++i)
+            {
+                out << ", \"" << event_names[i] << "\": ";
+                if (r.available[i])
+                {
+                    out << c.values[i];
+                }
+                else
+                {
+                    out << "null";
+                }
+            }
+            out << ", \"ipc\": ";
+            if (r.available[0] && r.available[1] && c.values[0])
+            {
+                out << static_cast<double>(c.values[1]) / static_cast<double>(c.values[0]);
+            }
+            else
+            {
+                out << "null";
+            }
+            out << "}";
+            first = false;
+        }
+        out << "\n]}" << std::endl;
+    }
+
+} // namespace big::perf
+
+#else
+
+#define PERF_SCOPE(NAME)
+#define PERF_SCOPE_AT(PHASE)
+#define PERF_THREAD()
+
+#endif//PERF
+
+#endif//__PERF_H
@@ -0,0 +1,197 @@
+/* Allocation and operation-size histograms (PROFILE builds only)
+ *
+ * Counts every heap allocation (from the operator new in num/memory.cpp, in
+ * the binaries that link it), every copy of a num_t, and every product and
+ * square, by backend and operand size (in powers of two bytes or bits),
+ * along with the time spent in each backend, and prints the histograms to
+ * stderr at exit. The counters are fixed arrays of atomics, so counting never
+ * allocates (nor takes a lock).
+ *
+ * Without PROFILE, the macros below expand to nothing, and num_t keeps its
+ * implicit copies.
+ */
+
+#ifndef __PROFILE_H
+#define __PROFILE_H
+
+#ifdef PROFILE
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <typeinfo>
+
+#include <cxxabi.h>
+
+#define PROFILE_CAT_(A, B) A##B
+#define PROFILE_CAT(A, B) PROFILE_CAT_(A, B)
+#define PROFILE_ALLOC(BYTES) ::big::profile::stats().allocations.add(BYTES)
+#define PROFILE_COPY(BYTES) ::big::profile::stats().copies.add(BYTES)
+#define PROFILE_PRODUCT(MUL, BITS) ::big::profile::timer<MUL> PROFILE_CAT(profile_timer_, __LINE__)(BITS)
+
+namespace big::profile
+{
+
+    constexpr size_t buckets = 64;     // by floor(log2(size))
+    constexpr size_t max_backends = 16;
+
+    struct histogram
+    {
+        std::array<std::atomic<std::uint64_t>, buckets> count {};
+        std::array<std::atomic<std::uint64_t>, buckets> total {}; // sum of sizes
+
+        inline void add(size_t size);
+    };
+
+    struct backend_stats
+    {
+        std::atomic<const std::type_info *> type { nullptr };
+        histogram sizes; // operand bits
+        std::atomic<std::uint64_t> nanoseconds { 0 };
+    };
+
+    struct registry
+    {
+        histogram allocations; // bytes
+        histogram copies;      // bytes
+        std::array<backend_stats, max_backends> backends;
+        std::atomic<size_t> used { 0 };
+
+        inline registry();
+    };
+
+    /* never destroyed, so allocations made during static destruction can
+     * still be counted
+     */
+    inline registry &stats();
+
+    /* times a product (or square) of Mul, from construction to destruction */
+    template<typename Mul>
+    class timer
+    {
+        backend_stats *backend;
+        std::chrono::steady_clock::time_point start;
+
+    public:
+        explicit inline timer(size_t bits);
+        inline ~timer();
+    };
+
+    //////////////// IMPLEMENTATIONS ////////////////
+
+    void histogram::add(size_t size)
+    {
+        size_t bucket = size ? std::bit_width(size) - 1 : 0;
+        count[bucket].fetch_add(1, std::memory_order_relaxed);
+        total[bucket].fetch_add(size, std::memory_order_relaxed);
+    }
+
+    inline void print(const char *title, const char *unit, const histogram &h)
+    {
+        std::uint64_t count = 0;
+        std::uint64_t total = 0;
+        for (size_t i = 0; i < buckets; ++i)
+        {
+            count += h.count[i];
+            total += h.total[i];
+        }
+        std::fprintf(stderr, "%s: %llu (%llu %s)\n", title,
+                static_cast<unsigned long long>(count), static_cast<unsigned long long>(total), unit);
+        for (size_t i = 0; i < buckets; ++i)
+        {
+            if (h.count[i])
+            {
+                std::fprintf(stderr, "    %s 2^%-2zu %12llu %16llu\n", unit, i,
+                        static_cast<unsigned long long>(h.count[i]), static_cast<unsigned long long>(h.total[i]));
+            }
+        }
+    }
+
+    inline void dump()
+    {
+        registry &r = stats();
+        std::fprintf(stderr, "==== profile ====\n");
+        print("allocations", "bytes", r.allocations);
+        print("num_t copies", "bytes", r.copies);
+        for (size_t i = 0; i < r.used && i < max_backends; ++i)
+        {
+            const backend_stats &b = r.backends[i];
+            const std::type_info *type = b.type;
+            if (!type)
+            {
+                continue;
+            }
+            int status;
+            char *name = abi::__cxa_demangle(type->name(), nullptr, nullptr, &status);
+            std::fprintf(stderr, "products with %s: %.6fs\n", status == 0 ? name : type->name(), b.nanoseconds * 1e-9);
+            std::free(name);
+            print("    operands", "bits", b.sizes);
+        }
+    }
+
+    registry::registry()
+    {
+        std::atexit(dump);
+    }
+
+    registry &stats()
+    {
+        static registry *r = new (std::malloc(sizeof(registry))) registry;
+        return *r;
+    }
+
+    /* the slot of a backend (claimed on first use) */
+    template<typename Mul>
+    backend_stats *backend()
+    {
+        static backend_stats *slot = []
+        {
+            registry &r = stats();
+            size_t i = r.used.fetch_add(1);
+            if (i >= max_backends)
+            {
+                return static_cast<backend_stats *>(nullptr);
+            }
+            r.backends[i].type = &typeid(Mul);
+            return &r.backends[i];
+        }();
+        return slot;
+    }
+
+    template<typename Mul>
+    timer<Mul>::timer(size_t bits)
+        : backend(profile::backend<Mul>())
+        , start(std::chrono::steady_clock::now())
+    {
+        if (backend)
+        {
+            backend->sizes.add(bits);
+        }
+    }
+
+    template<typename Mul>
+    timer<Mul>::~timer()
+    {
+        if (backend)
+        {
+            auto delta = std::chrono::steady_clock::now() - start;
+            backend->nanoseconds.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(delta).count(), std::memory_order_relaxed);
+        }
+    }
+
+} // namespace big::profile
+
+#else
+
+#define PROFILE_ALLOC(BYTES)
+#define PROFILE_COPY(BYTES)
+#define PROFILE_PRODUCT(MUL, BITS)
+
+#endif//PROFILE
+
+#endif//__PROFILE_H
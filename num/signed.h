@@ -0,0 +1,170 @@
+/* Signed wrapper around num_t (needed by the 7-multiplication matrix schemes)
+ */
+
+#ifndef __SIGNED_H
+#define __SIGNED_H
+
+#include "num/number.h"
+
+namespace big
+{
+
+    template<UInt T>
+    struct sint_t
+    {
+        enum class sign_t
+        {
+            ZERO,
+            POS,
+            NEG,
+        };
+
+        num_t<T> abs;
+        sign_t sign = sign_t::ZERO;
+
+        sint_t() {}
+        sint_t(num_t<T> value, sign_t sign=sign_t::POS) : abs(std::move(value)), sign(sign)
+        {
+            if (abs.value.empty())
+            {
+                this->sign = sign_t::ZERO;
+            }
+        }
+        template<Int I>
+        sint_t(const I x) : sint_t(num_t<T>(x)) {}
+
+        template<UInt S>
+        explicit operator num_t<S>() const { return static_cast<num_t<S>>(abs); }
+        sign_t signum() const { return sign; }
+
+        inline void flip_sign();
+        std::string str(bool=false) const;
+
+        inline sint_t &operator+=(const sint_t &);
+        inline sint_t &operator-=(const sint_t &);
+    };
+
+    template<UInt T>
+    inline sint_t<T> operator-(sint_t<T>);
+    template<UInt T>
+    inline sint_t<T> operator+(sint_t<T>, const sint_t<T> &);
+    template<UInt T>
+    inline sint_t<T> operator-(sint_t<T>, const sint_t<T> &);
+
+    /* multiplies via a backend (see num/mulnum_*.h), through big::product */
+    template<typename Mul, UInt T>
+    inline sint_t<T> product(const sint_t<T> &, const sint_t<T> &);
+
+    //////////////// IMPLEMENTATIONS ////////////////
+
+    template<UInt T>
+    void sint_t<T>::flip_sign()
+    {
+        switch(sign)
+        {
+            case sign_t::POS:
+                sign = sign_t::NEG;
+                break;
+            case sign_t::NEG:
+                sign = sign_t::POS;
+                break;
+            default:
+                break;
+        }
+    }
+
+    template<UInt T>
+    std::string sint_t<T>::str(bool full) const
+    {
+        switch (sign)
+        {
+            case sign_t::POS:
+                return "+" + abs.str(full);
+            case sign_t::NEG:
+                return "-" + abs.str(full);
+            default:
+                return "0";
+        }
+    }
+
+    template<UInt T>
+    sint_t<T> &sint_t<T>::operator+=(const sint_t<T> &other)
+    {
+        if (other.sign == sign_t::ZERO)
+        {
+            return *this;
+        }
+        if (sign == sign_t::ZERO)
+        {
+            return *this = other;
+        }
+
+        if (sign == other.sign)
+        {
+            abs += other.abs;
+            return *this;
+        }
+
+#ifdef DEBUG
+        sint_t<T> old_this(*this);
+#endif
+
+        std::strong_ordering cmp = abs <=> other.abs;
+        if (cmp == std::strong_ordering::greater)
+        {
+            abs -= other.abs;
+        }
+        else if (cmp == std::strong_ordering::less)
+        {
+            flip_sign();
+            abs = other.abs - abs;
+        }
+        else
+        {
+            sign = sign_t::ZERO;
+            abs.value.clear();
+        }
+        DB(cerr << old_this.str(true) << " + " << other.str(true) << " == " << str(true) << endl);
+        return *this;
+    }
+
+    template<UInt T>
+    sint_t<T> &sint_t<T>::operator-=(const sint_t<T> &other)
+    {
+        return *this += -other;
+    }
+
+    template<UInt T>
+    sint_t<T> operator-(sint_t<T> x)
+    {
+        x.flip_sign();
+        return x;
+    }
+    template<UInt T>
+    sint_t<T> operator+(sint_t<T> lhs, const sint_t<T> &rhs)
+    {
+        return lhs += rhs;
+    }
+    template<UInt T>
+    sint_t<T> operator-(sint_t<T> lhs, const sint_t<T> &rhs)
+    {
+        return lhs -= rhs;
+    }
+
+    template<typename Mul, UInt T>
+    sint_t<T> product(const sint_t<T> &lhs, const sint_t<T> &rhs)
+    {
+        using sign_t = sint_t<T>::sign_t;
+        if (lhs.sign == sign_t::ZERO || rhs.sign == sign_t::ZERO)
+        {
+            return {};
+        }
+        return sint_t<T>(
+                product<Mul>(lhs.abs, rhs.abs),
+                lhs.sign == rhs.sign ? sign_t::POS : sign_t::NEG
+                );
+    }
+
+} // namespace big
+
+#endif//__SIGNED_H
@@ -0,0 +1,166 @@
+/* Fixed pool of worker threads for data-parallel loops
+ *
+ * Only one loop runs at a time, and the calling thread takes part in it, so
+ * loops never wait on each other (divide-and-conquer callers should run
+ * one parallel loop per level of recursion). A loop started while another
+ * one runs (from another thread, or nested in a loop body) runs serially
+ * on its calling thread instead.
+ */
+
+#ifndef __THREAD_POOL_H
+#define __THREAD_POOL_H
+
+#include "num/perf.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace big
+{
+
+    class thread_pool
+    {
+        std::vector<std::thread> workers;
+
+        std::mutex lock;
+        std::condition_variable wake;     // workers wait for a new loop
+        std::condition_variable finished; // the caller waits for the workers
+        size_t generation = 0;
+        size_t busy = 0;
+        bool running = false; // a loop owns the workers
+        bool stop = false;
+
+        const std::function<void(size_t)> *body = nullptr;
+        size_t count = 0;
+        std::atomic<size_t> next;
+
+        inline void run();
+        inline void work();
+
+    public:
+        /* threads includes the calling thread */
+        explicit inline thread_pool(unsigned threads=std::thread::hardware_concurrency());
+        inline ~thread_pool();
+
+        thread_pool(const thread_pool &) = delete;
+        thread_pool &operator=(const thread_pool &) = delete;
+
+        size_t size() const { return workers.size() + 1; }
+
+        /* calls body(i) for every i < count, in any order and on any thread
+         * (only on the calling thread if the pool is already running a loop)
+         */
+        inline void parallel_for(size_t count, const std::function<void(size_t)> &body);
+
+        /* one pool for the whole process (sized to the machine) */
+        static inline thread_pool &shared();
+    };
+
+    //////////////// IMPLEMENTATIONS ////////////////
+
+    thread_pool::thread_pool(unsigned threads)
+    {
+        for (unsigned i = 1; i < threads; ++i)
+        {
+            workers.emplace_back([this] { run(); });
+        }
+    }
+
+    thread_pool::~thread_pool()
+    {
+        {
+            std::lock_guard guard(lock);
+            stop = true;
+        }
+        wake.notify_all();
+        for (std::thread &worker : workers)
+        {
+            worker.join();
+        }
+    }
+
+    void thread_pool::run()
+    {
+        PERF_THREAD();
+        size_t seen = 0;
+        while (true)
+        {
+            {
+                std::unique_lock guard(lock);
+                wake.wait(guard, [&] { return stop || generation != seen; });
+                if (stop)
+                {
+                    return;
+                }
+                seen = generation;
+            }
+            work();
+            {
+                std::lock_guard guard(lock);
+                --busy;
+            }
+            finished.notify_one();
+        }
+    }
+
+    void thread_pool::work()
+    {
+        for (size_t i; (i = next.fetch_add(1, std::memory_order_relaxed)) < count; )
+        {
+            (*body)(i);
+        }
+    }
+
+    void thread_pool::parallel_for(size_t n, const std::function<void(size_t)> &f)
+    {
+        auto serial = [&]
+        {
+            for (size_t i = 0; i < n; ++i)
+            {
+                f(i);
+            }
+        };
+        if (workers.empty() || n <= 1)
+        {
+            serial();
+            return;
+        }
+
+        {
+            std::unique_lock guard(lock);
+            if (running)
+            {
+                guard.unlock();
+                serial();
+                return;
+            }
+            running = true;
+            body = &f;
+            count = n;
+            next = 0;
+            busy = workers.size();
+            ++generation;
+        }
+        wake.notify_all();
+        work();
+
+        std::unique_lock guard(lock);
+        finished.wait(guard, [this] { return busy == 0; });
+        body = nullptr;
+        running = false;
+    }
+
+    thread_pool &thread_pool::shared()
+    {
+        static thread_pool pool;
+        return pool;
+    }
+
+} // namespace big
+
+#endif//__THREAD_POOL_H
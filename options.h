@@ -0,0 +1,34 @@
+/* Command-line values, shared by the drivers (eval.cpp, fibsonicci.cpp,
+ * check.cpp and microbench.cpp)
+ */
+
+#ifndef __OPTIONS_H
+#define __OPTIONS_H
+
+#include <charconv>
+#include <string_view>
+#include <system_error>
+
+/* parses all of s into out, if it is a number in [lo, hi] (otherwise, returns
+ * false and leaves out alone)
+ */
+template<typename T>
+inline bool parse_option(std::string_view s, T &out, T lo, T hi);
+
+//////////////// IMPLEMENTATIONS ////////////////
+
+template<typename T>
+bool parse_option(std::string_view s, T &out, T lo, T hi)
+{
+    T parsed;
+    auto [end, error] = std::from_chars(s.data(), s.data() + s.size(), parsed);
+    // (written so that NaN is out of range)
+    if (error != std::errc() || end != s.data() + s.size() || !(lo <= parsed && parsed <= hi))
+    {
+        return false;
+    }
+    out = parsed;
+    return true;
+}
+
+#endif//__OPTIONS_H